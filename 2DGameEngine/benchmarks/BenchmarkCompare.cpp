@@ -0,0 +1,462 @@
+// Compares benchmark results (ECSBenchmark or the stress test JSON) and flags the regressions
+// Usage: BenchmarkCompare <baseline.json>[,<baseline.json>...] <candidate.json>[,<candidate.json>...] [--threshold 5] [--resamples 2000]
+// Every file is one process run and gives one sample per benchmark (the median of its repetitions): repetitions inside a
+// process share its caches, heap and clock state, so they aren't independent. Run the baseline and the candidate builds
+// alternately, several times each, and pass all the files
+// Returns 1 when at least one benchmark got slower than the threshold, by more than the spread inside the runs, with a 95%
+// bootstrap interval of the median ratio above 1 and a Mann-Whitney p-value under 0.05 after the Holm correction for
+// comparing every benchmark at once
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CommandLine/ParseNumber.h"
+#include "Metrics/Percentile.h"
+
+// Just enough JSON to read our own result files
+struct JsonValue {
+	enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+	Type type = JSON_NULL;
+	double number = 0.0;
+	std::string text;
+	std::vector<JsonValue> items;
+	std::map<std::string, JsonValue> members;
+
+	const JsonValue* Get(const std::string& key) const {
+		auto member = members.find(key);
+		return member != members.end() ? &member->second : nullptr;
+	}
+};
+
+class JsonParser {
+private:
+	const std::string& input;
+	size_t position = 0;
+
+	void SkipWhitespace() {
+		while (position < input.size() && std::isspace(static_cast<unsigned char>(input[position]))) {
+			position++;
+		}
+	}
+	bool Consume(char expected) {
+		SkipWhitespace();
+		if (position < input.size() && input[position] == expected) {
+			position++;
+			return true;
+		}
+		return false;
+	}
+	std::string ParseString() {
+		std::string result;
+		position++; // opening quote
+		while (position < input.size() && input[position] != '"') {
+			if (input[position] == '\\' && position + 1 < input.size()) {
+				position++;
+			}
+			result += input[position++];
+		}
+		position++; // closing quote
+		return result;
+	}
+public:
+	JsonParser(const std::string& input): input(input) {}
+
+	bool Parse(JsonValue& value) {
+		SkipWhitespace();
+		if (position >= input.size()) {
+			return false;
+		}
+
+		const char next = input[position];
+		if (next == '{') {
+			value.type = JsonValue::JSON_OBJECT;
+			position++;
+			if (Consume('}')) {
+				return true;
+			}
+			do {
+				SkipWhitespace();
+				if (position >= input.size() || input[position] != '"') {
+					return false;
+				}
+				std::string key = ParseString();
+				if (!Consume(':') || !Parse(value.members[key])) {
+					return false;
+				}
+			} while (Consume(','));
+			return Consume('}');
+		}
+		if (next == '[') {
+			value.type = JsonValue::JSON_ARRAY;
+			position++;
+			if (Consume(']')) {
+				return true;
+			}
+			do {
+				value.items.emplace_back();
+				if (!Parse(value.items.back())) {
+					return false;
+				}
+			} while (Consume(','));
+			return Consume(']');
+		}
+		if (next == '"') {
+			value.type = JsonValue::JSON_STRING;
+			value.text = ParseString();
+			return true;
+		}
+		if (input.compare(position, 4, "true") == 0 || input.compare(position, 5, "false") == 0) {
+			value.type = JsonValue::JSON_BOOL;
+			value.number = input[position] == 't' ? 1.0 : 0.0;
+			position += input[position] == 't' ? 4 : 5;
+			return true;
+		}
+		if (input.compare(position, 4, "null") == 0) {
+			position += 4;
+			return true;
+		}
+
+		char* end = nullptr;
+		value.type = JsonValue::JSON_NUMBER;
+		value.number = std::strtod(input.c_str() + position, &end);
+		if (end == input.c_str() + position) {
+			return false;
+		}
+		position = end - input.c_str();
+		return true;
+	}
+};
+
+// Samples of one benchmark, in nanoseconds per operation, one per process run
+// withinRunSpread is the largest max - min of the repetitions of one run, what the timings move without any change
+struct BenchmarkSamples {
+	std::vector<double> samples;
+	double withinRunSpread = 0.0;
+};
+
+typedef std::map<std::string, BenchmarkSamples> BenchmarkSet;
+
+static bool LoadResults(const std::string& filePath, BenchmarkSet& results) {
+	std::ifstream file(filePath);
+	if (!file) {
+		std::cerr << "Can't open " << filePath << std::endl;
+		return false;
+	}
+	std::stringstream content;
+	content << file.rdbuf();
+	const std::string input = content.str();
+
+	JsonValue root;
+	if (!JsonParser(input).Parse(root) || root.type != JsonValue::JSON_OBJECT || !root.Get("results")) {
+		std::cerr << "Invalid benchmark results: " << filePath << std::endl;
+		return false;
+	}
+
+	for (const auto& result: root.Get("results")->items) {
+		const JsonValue* name = result.Get("name");
+		const JsonValue* entities = result.Get("entities");
+		if (!name || !entities) {
+			continue;
+		}
+
+		// Repeated samples when we have them, a single mean otherwise
+		std::vector<double> repetitions;
+		if (const JsonValue* samples = result.Get("samples_ns_per_op")) {
+			for (const auto& sample: samples->items) {
+				repetitions.push_back(sample.number);
+			}
+		} else if (const JsonValue* mean = result.Get("mean_ns_per_op")) {
+			repetitions.push_back(mean->number);
+		}
+		if (repetitions.empty()) {
+			continue;
+		}
+		std::sort(repetitions.begin(), repetitions.end());
+
+		BenchmarkSamples& benchmarkSamples = results[name->text + " @ " + std::to_string(static_cast<long long>(entities->number))];
+		benchmarkSamples.samples.push_back(GetPercentile(repetitions, 50));
+		benchmarkSamples.withinRunSpread = std::max(benchmarkSamples.withinRunSpread, repetitions.back() - repetitions.front());
+	}
+	return true;
+}
+
+// Comma separated list of result files, each one a process run
+static bool LoadRuns(const std::string& fileList, BenchmarkSet& results) {
+	std::stringstream stream(fileList);
+	std::string filePath;
+	while (std::getline(stream, filePath, ',')) {
+		if (!filePath.empty() && !LoadResults(filePath, results)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static double Median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return GetPercentile(values, 50);
+}
+
+// 95% bootstrap confidence interval of median(candidate) / median(baseline)
+static void BootstrapRatioInterval(const std::vector<double>& baseline, const std::vector<double>& candidate, int resamples, double& low, double& high) {
+	std::mt19937 random(42);
+	std::vector<double> ratios;
+	ratios.reserve(resamples);
+
+	std::vector<double> baselineResample(baseline.size());
+	std::vector<double> candidateResample(candidate.size());
+	std::uniform_int_distribution<size_t> pickBaseline(0, baseline.size() - 1);
+	std::uniform_int_distribution<size_t> pickCandidate(0, candidate.size() - 1);
+
+	for (int i = 0; i < resamples; i++) {
+		for (auto& value: baselineResample) {
+			value = baseline[pickBaseline(random)];
+		}
+		for (auto& value: candidateResample) {
+			value = candidate[pickCandidate(random)];
+		}
+		const double baselineMedian = Median(baselineResample);
+		if (baselineMedian > 0.0) {
+			ratios.push_back(Median(candidateResample) / baselineMedian);
+		}
+	}
+
+	std::sort(ratios.begin(), ratios.end());
+	if (ratios.empty()) {
+		low = high = 1.0;
+		return;
+	}
+	low = GetPercentile(ratios, 2.5);
+	high = GetPercentile(ratios, 97.5);
+}
+
+// Two sided Mann-Whitney U test with the normal approximation, returns the p-value
+// It doesn't assume the timings are normally distributed, which they never are
+static double MannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b) {
+	struct RankedValue {
+		double value;
+		bool isFromA;
+	};
+	std::vector<RankedValue> all;
+	for (auto value: a) {
+		all.push_back(RankedValue{ value, true });
+	}
+	for (auto value: b) {
+		all.push_back(RankedValue{ value, false });
+	}
+	std::sort(all.begin(), all.end(), [](const RankedValue& x, const RankedValue& y) {
+		return x.value < y.value;
+	});
+
+	// Ties share the average of their ranks
+	double rankSumA = 0.0;
+	double tieCorrection = 0.0;
+	for (size_t i = 0; i < all.size();) {
+		size_t j = i;
+		while (j < all.size() && all[j].value == all[i].value) {
+			j++;
+		}
+		const double averageRank = (i + 1 + j) / 2.0;
+		const double tied = static_cast<double>(j - i);
+		tieCorrection += tied * tied * tied - tied;
+		for (size_t k = i; k < j; k++) {
+			if (all[k].isFromA) {
+				rankSumA += averageRank;
+			}
+		}
+		i = j;
+	}
+
+	const double n1 = static_cast<double>(a.size());
+	const double n2 = static_cast<double>(b.size());
+	const double n = n1 + n2;
+	const double u = rankSumA - n1 * (n1 + 1) / 2.0;
+	const double mean = n1 * n2 / 2.0;
+	const double variance = n1 * n2 / 12.0 * ((n + 1) - tieCorrection / (n * (n - 1)));
+	if (variance <= 0.0) {
+		return 1.0;
+	}
+
+	const double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+	return std::erfc(std::max(0.0, z) / std::sqrt(2.0));
+}
+
+// Smallest p-value the test can give with these sample counts, when every sample of one side is below the other side
+static double MinimumMannWhitneyPValue(size_t n1, size_t n2) {
+	std::vector<double> a(n1);
+	std::vector<double> b(n2);
+	for (size_t i = 0; i < n1; i++) {
+		a[i] = static_cast<double>(i);
+	}
+	for (size_t i = 0; i < n2; i++) {
+		b[i] = static_cast<double>(n1 + i);
+	}
+	return MannWhitneyPValue(a, b);
+}
+
+static const char* USAGE =
+	"Usage: BenchmarkCompare <baseline.json>[,<baseline.json>...] <candidate.json>[,<candidate.json>...]\n"
+	"                        [--threshold <percent>] [--resamples <count>]\n";
+
+// One benchmark found in both sets
+struct Comparison {
+	std::string name;
+	double baselineMedian;
+	double candidateMedian;
+	double ratio;
+	double low = 1.0;
+	double high = 1.0;
+	double pValue = 1.0;
+	double noiseFloor;
+	bool hasEnoughSamples;
+	std::string verdict = "same";
+};
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << USAGE;
+		return 2;
+	}
+
+	double thresholdPercent = 5.0;
+	int resamples = 2000;
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threshold" && i + 1 < argc) {
+			if (!ParseNumber(arg, argv[++i], thresholdPercent, USAGE) || thresholdPercent < 0.0) {
+				return 2;
+			}
+		} else if (arg == "--resamples" && i + 1 < argc) {
+			if (!ParseNumber(arg, argv[++i], resamples, USAGE)) {
+				return 2;
+			}
+			resamples = std::max(100, resamples);
+		} else {
+			std::cerr << "Unknown argument: " << arg << std::endl << USAGE;
+			return 2;
+		}
+	}
+
+	BenchmarkSet baseline;
+	BenchmarkSet candidate;
+	if (!LoadRuns(argv[1], baseline) || !LoadRuns(argv[2], candidate)) {
+		return 2;
+	}
+
+	std::vector<Comparison> comparisons;
+	for (const auto& entry: candidate) {
+		auto baselineEntry = baseline.find(entry.first);
+		if (baselineEntry == baseline.end()) {
+			continue;
+		}
+		const auto& baselineSamples = baselineEntry->second.samples;
+		const auto& candidateSamples = entry.second.samples;
+
+		Comparison comparison;
+		comparison.name = entry.first;
+		comparison.baselineMedian = Median(baselineSamples);
+		comparison.candidateMedian = Median(candidateSamples);
+		comparison.ratio = comparison.baselineMedian > 0.0 ? comparison.candidateMedian / comparison.baselineMedian : 1.0;
+		comparison.noiseFloor = std::max(baselineEntry->second.withinRunSpread, entry.second.withinRunSpread);
+
+		// A single run has no spread between runs, so it can only be reported, never flagged
+		comparison.hasEnoughSamples = baselineSamples.size() >= 2 && candidateSamples.size() >= 2;
+		if (comparison.hasEnoughSamples) {
+			BootstrapRatioInterval(baselineSamples, candidateSamples, resamples, comparison.low, comparison.high);
+			comparison.pValue = MannWhitneyPValue(baselineSamples, candidateSamples);
+		}
+		comparisons.push_back(comparison);
+	}
+
+	// Holm correction: with m tests the smallest p-value has to be under 0.05 / m, the next one under 0.05 / (m - 1) and so on
+	// The adjusted p-values are min(1, (m - rank) * p), kept increasing in the order of the raw ones
+	std::vector<Comparison*> tested;
+	for (auto& comparison: comparisons) {
+		if (comparison.hasEnoughSamples) {
+			tested.push_back(&comparison);
+		}
+	}
+	std::sort(tested.begin(), tested.end(), [](const Comparison* a, const Comparison* b) {
+		return a->pValue < b->pValue;
+	});
+	const size_t numTests = tested.size();
+	double adjustedPValue = 0.0;
+	for (size_t rank = 0; rank < numTests; rank++) {
+		adjustedPValue = std::min(1.0, std::max(adjustedPValue, (numTests - rank) * tested[rank]->pValue));
+		tested[rank]->pValue = adjustedPValue;
+	}
+
+	const double threshold = thresholdPercent / 100.0;
+	int numRegressions = 0;
+	int numImprovements = 0;
+	int numUndecidable = 0;
+	size_t fewestRuns = SIZE_MAX;
+	for (auto& comparison: comparisons) {
+		const auto& baselineSamples = baseline[comparison.name].samples;
+		const auto& candidateSamples = candidate[comparison.name].samples;
+		fewestRuns = std::min(fewestRuns, std::min(baselineSamples.size(), candidateSamples.size()));
+
+		// Even a clean separation of the runs has to get through the strictest Holm level, or nothing could ever be flagged
+		if (!comparison.hasEnoughSamples || MinimumMannWhitneyPValue(baselineSamples.size(), candidateSamples.size()) * numTests >= 0.05) {
+			comparison.verdict = "not enough runs";
+			numUndecidable++;
+			continue;
+		}
+
+		// Only a change that is bigger than the threshold, than the spread inside a run and than the noise between runs counts
+		const bool isSignificant = comparison.pValue < 0.05;
+		const bool isAboveNoise = std::fabs(comparison.candidateMedian - comparison.baselineMedian) > comparison.noiseFloor;
+		if (comparison.ratio > 1.0 + threshold && comparison.low > 1.0 && isSignificant && isAboveNoise) {
+			comparison.verdict = "REGRESSION";
+			numRegressions++;
+		} else if (comparison.ratio < 1.0 - threshold && comparison.high < 1.0 && isSignificant && isAboveNoise) {
+			comparison.verdict = "improvement";
+			numImprovements++;
+		}
+	}
+
+	std::printf("%-36s %14s %14s %9s %19s %7s  %s\n", "Benchmark", "Baseline ns", "Candidate ns", "Change", "95% CI", "p Holm", "Verdict");
+	for (const auto& comparison: comparisons) {
+		char interval[32] = "-";
+		char pValueText[16] = "-";
+		if (comparison.hasEnoughSamples) {
+			std::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", (comparison.low - 1.0) * 100.0, (comparison.high - 1.0) * 100.0);
+			std::snprintf(pValueText, sizeof(pValueText), "%.3f", comparison.pValue);
+		}
+		std::printf("%-36s %14.2f %14.2f %+8.1f%% %19s %7s  %s\n", comparison.name.c_str(), comparison.baselineMedian, comparison.candidateMedian,
+			(comparison.ratio - 1.0) * 100.0, interval, pValueText, comparison.verdict.c_str());
+	}
+	for (const auto& entry: candidate) {
+		if (baseline.find(entry.first) == baseline.end()) {
+			std::printf("%-36s %14s %14.2f %9s %19s %7s  %s\n", entry.first.c_str(), "-", Median(entry.second.samples), "-", "-", "-", "new");
+		}
+	}
+	for (const auto& entry: baseline) {
+		if (candidate.find(entry.first) == candidate.end()) {
+			std::printf("%-36s %14.2f %14s %9s %19s %7s  %s\n", entry.first.c_str(), Median(entry.second.samples), "-", "-", "-", "-", "missing");
+		}
+	}
+
+	std::printf("\n%d regression(s), %d improvement(s) with a %.1f%% threshold\n", numRegressions, numImprovements, thresholdPercent);
+	if (numUndecidable > 0) {
+		const size_t numComparisons = comparisons.size();
+		size_t runs = 2;
+		while (MinimumMannWhitneyPValue(runs, runs) * numComparisons >= 0.05) {
+			runs++;
+		}
+		std::fprintf(stderr, "Warning: %d benchmark(s) can't reach p < 0.05 over %zu comparisons with %zu run(s) per side, "
+			"pass %zu or more result files per side, from separate runs\n", numUndecidable, numComparisons, fewestRuns, runs);
+	}
+	return numRegressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,374 @@
+// Microbenchmarks of the Registry operations, the results are printed as JSON
+// Usage: ECSBenchmark [--sizes 1000,100000,1000000,10000000] [--repetitions 5] [--out results.json]
+// Every benchmark runs once untimed to warm up, then every repetition loops it until it has timed at least 10 ms
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CommandLine/ParseNumber.h"
+#include "ECS/ECS.h"
+#include "JobSystem/JobSystem.h"
+#include "Logger/Logger.h"
+#include "Logger/BinaryLog.h"
+#include "Metrics/Percentile.h"
+#include "Components/TransformComponent.h"
+#include "Components/RigidBodyComponent.h"
+#include "Systems/MovementSystem.h"
+#include "Renderer/RenderQueue.h"
+
+struct BenchmarkResult {
+	std::string name;
+	int entities;
+	int operations;
+	std::vector<double> nanosecsPerOperation;
+};
+
+// Keeps the compiler from optimizing away reads we don't use
+static volatile float sink;
+
+static double NanosecsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::unique_ptr<Registry> CreateRegistry() {
+	auto registry = std::make_unique<Registry>();
+	registry->AddSystem<MovementSystem>();
+	return registry;
+}
+
+// Registry with numEntities moving entities, already added to the systems
+static std::unique_ptr<Registry> CreatePopulatedRegistry(int numEntities) {
+	auto registry = CreateRegistry();
+	for (int i = 0; i < numEntities; i++) {
+		Entity entity = registry->CreateEntity();
+		entity.AddComponent<TransformComponent>(glm::vec2(i, i), glm::vec2(1.0, 1.0), 0.0);
+		entity.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 2.0));
+	}
+	registry->Update();
+	return registry;
+}
+
+// Each benchmark prepares its own registry and only times the operation itself, returns the elapsed nanoseconds
+typedef std::function<double(int numEntities, int& operations)> Benchmark;
+
+static double BenchmarkCreateEntity(int numEntities, int& operations) {
+	auto registry = CreateRegistry();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numEntities; i++) {
+		registry->CreateEntity();
+	}
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+static double BenchmarkAddComponent(int numEntities, int& operations) {
+	auto registry = CreateRegistry();
+	std::vector<Entity> entities;
+	entities.reserve(numEntities);
+	for (int i = 0; i < numEntities; i++) {
+		entities.push_back(registry->CreateEntity());
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (auto& entity: entities) {
+		entity.AddComponent<TransformComponent>(glm::vec2(1.0, 1.0), glm::vec2(1.0, 1.0), 0.0);
+		entity.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 2.0));
+	}
+	operations = numEntities * 2;
+	return NanosecsSince(start);
+}
+
+static double BenchmarkAddEntitiesToSystems(int numEntities, int& operations) {
+	auto registry = CreateRegistry();
+	for (int i = 0; i < numEntities; i++) {
+		Entity entity = registry->CreateEntity();
+		entity.AddComponent<TransformComponent>();
+		entity.AddComponent<RigidBodyComponent>();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	registry->Update();
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+static double BenchmarkGetComponent(int numEntities, int& operations) {
+	auto registry = CreatePopulatedRegistry(numEntities);
+	Entity entity(0);
+	entity.registry = registry.get();
+
+	auto start = std::chrono::steady_clock::now();
+	float sum = 0.0f;
+	for (int i = 0; i < numEntities; i++) {
+		entity = Entity(i);
+		sum += registry->GetComponent<TransformComponent>(entity).position.x;
+	}
+	sink = sum;
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+static JobSystem* jobSystem = nullptr;
+
+static double BenchmarkMovementSystem(int numEntities, int& operations) {
+	auto registry = CreatePopulatedRegistry(numEntities);
+	auto& movementSystem = registry->GetSystem<MovementSystem>();
+
+	auto start = std::chrono::steady_clock::now();
+	movementSystem.Update(1.0 / 60.0, *jobSystem);
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+static double BenchmarkRemoveComponent(int numEntities, int& operations) {
+	auto registry = CreatePopulatedRegistry(numEntities);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numEntities; i++) {
+		registry->RemoveComponent<RigidBodyComponent>(Entity(i));
+	}
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+// Kills and respawns a slice of the entities every frame, like units dying and spawning in a match
+static double BenchmarkDespawnChurn(int numEntities, int& operations) {
+	auto registry = CreatePopulatedRegistry(numEntities);
+	const int churnPerFrame = std::max(1, std::min(numEntities / 100, 100));
+	const int numFrames = 10;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < numFrames; frame++) {
+		for (int i = 0; i < churnPerFrame; i++) {
+			Entity entity((frame * churnPerFrame + i) % numEntities);
+			entity.registry = registry.get();
+			entity.Kill();
+		}
+		registry->Update();
+
+		for (int i = 0; i < churnPerFrame; i++) {
+			Entity entity = registry->CreateEntity();
+			entity.AddComponent<TransformComponent>();
+			entity.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 2.0));
+		}
+		registry->Update();
+	}
+	operations = churnPerFrame * numFrames;
+	return NanosecsSince(start);
+}
+
+// The component log of AddComponent into an open binary log, capped so the file stays small at the largest sizes
+static double BenchmarkBinaryLogWrite(int numEntities, int& operations) {
+	const int numEvents = std::min(numEntities, 1000000);
+	const std::string filePath = (std::filesystem::temp_directory_path() / "ECSBenchmark.blog").string();
+	if (!BinaryLog::Open(filePath, numEvents * 32ull + (1 << 20))) {
+		operations = 0;
+		return 0.0;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numEvents; i++) {
+		LOG_BIN(LOG_DEBUG, LOG_CATEGORY_ECS, "Component id: {} was added to entity id: {}", i & 31, i);
+	}
+	const double nanosecs = NanosecsSince(start);
+	operations = numEvents;
+
+	BinaryLog::Close();
+	std::remove(filePath.c_str());
+	return nanosecs;
+}
+
+// Sprites spread over a few layers and textures, at random heights on a 720 pixel screen
+static void PushSprites(RenderQueue& renderQueue, const std::vector<float>& depths) {
+	renderQueue.Clear();
+	for (size_t i = 0; i < depths.size(); i++) {
+		renderQueue.Push(RenderQueue::MakeKey(static_cast<int>(i % 4), static_cast<uint16_t>(i % 3), depths[i]));
+	}
+}
+
+static std::vector<float> RandomDepths(int numEntities) {
+	std::vector<float> depths(numEntities);
+	uint32_t seed = 12345;
+	for (float& depth: depths) {
+		seed = seed * 1664525u + 1013904223u;
+		depth = static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * 720.0f;
+	}
+	return depths;
+}
+
+static double BenchmarkRenderQueueFullSort(int numEntities, int& operations) {
+	RenderQueue renderQueue;
+	PushSprites(renderQueue, RandomDepths(numEntities));
+
+	auto start = std::chrono::steady_clock::now();
+	renderQueue.Sort();
+	operations = numEntities;
+	return NanosecsSince(start);
+}
+
+// The next frame: every sprite moved a little, most of them keep their place in the order
+static double BenchmarkRenderQueueCoherentSort(int numEntities, int& operations) {
+	RenderQueue renderQueue;
+	std::vector<float> depths = RandomDepths(numEntities);
+	PushSprites(renderQueue, depths);
+	renderQueue.Sort();
+	for (size_t i = 0; i < depths.size(); i++) {
+		depths[i] += (i % 2) ? 0.25f : -0.25f;
+	}
+	PushSprites(renderQueue, depths);
+
+	auto start = std::chrono::steady_clock::now();
+	renderQueue.Sort();
+	operations = numEntities;
+	sink = static_cast<float>(renderQueue.WasLastSortIncremental());
+	return NanosecsSince(start);
+}
+
+static const char* USAGE = "Usage: ECSBenchmark [--sizes 1000,100000,1000000,10000000] [--repetitions 5] [--out results.json]\n";
+
+static bool ParseSizes(const std::string& flag, const std::string& list, std::vector<int>& sizes) {
+	sizes.clear();
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		int size = 0;
+		if (!ParseNumber(flag, item.c_str(), size, USAGE)) {
+			return false;
+		}
+		if (size <= 0) {
+			std::cerr << "Sizes have to be positive: " << item << std::endl << USAGE;
+			return false;
+		}
+		sizes.push_back(size);
+	}
+	if (sizes.empty()) {
+		std::cerr << "No sizes given" << std::endl << USAGE;
+		return false;
+	}
+	return true;
+}
+
+// A single call of the small sizes takes a few microseconds, too close to the clock and to whatever else the machine does
+static const double MIN_SAMPLE_NANOSECS = 10000000.0;
+
+// Calls the benchmark until the timed parts add up to MIN_SAMPLE_NANOSECS, returns the nanoseconds per operation
+static double RunSample(const Benchmark& benchmark, int numEntities, int& operations) {
+	double nanosecs = 0.0;
+	long long totalOperations = 0;
+	do {
+		operations = 0;
+		nanosecs += benchmark(numEntities, operations);
+		totalOperations += operations;
+	} while (operations > 0 && nanosecs < MIN_SAMPLE_NANOSECS);
+	return totalOperations > 0 ? nanosecs / totalOperations : 0.0;
+}
+
+static std::string ToJson(const std::vector<BenchmarkResult>& results, int repetitions) {
+	std::ostringstream json;
+	json << "{\n";
+	json << "  \"suite\": \"ecs\",\n";
+	json << "  \"threads\": " << jobSystem->GetNumWorkers() + 1 << ",\n";
+	json << "  \"repetitions\": " << repetitions << ",\n";
+	json << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& result = results[i];
+		std::vector<double> sorted = result.nanosecsPerOperation;
+		std::sort(sorted.begin(), sorted.end());
+
+		json << "    {\"name\": \"" << result.name << "\", \"entities\": " << result.entities;
+		json << ", \"operations\": " << result.operations;
+		json << ", \"median_ns_per_op\": " << GetPercentile(sorted, 50);
+		json << ", \"samples_ns_per_op\": [";
+		for (size_t j = 0; j < result.nanosecsPerOperation.size(); j++) {
+			json << (j > 0 ? ", " : "") << result.nanosecsPerOperation[j];
+		}
+		json << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n";
+	json << "}\n";
+	return json.str();
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<int> sizes = { 1000, 100000, 1000000, 10000000 };
+	int repetitions = 5;
+	std::string outFilePath;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--sizes" && i + 1 < argc) {
+			if (!ParseSizes(arg, argv[++i], sizes)) {
+				return 1;
+			}
+		} else if (arg == "--repetitions" && i + 1 < argc) {
+			if (!ParseNumber(arg, argv[++i], repetitions, USAGE)) {
+				return 1;
+			}
+			if (repetitions <= 0) {
+				std::cerr << "Repetitions have to be positive: " << repetitions << std::endl << USAGE;
+				return 1;
+			}
+		} else if (arg == "--out" && i + 1 < argc) {
+			outFilePath = argv[++i];
+		} else {
+			std::cerr << "Unknown argument: " << arg << std::endl << USAGE;
+			return 1;
+		}
+	}
+
+	// Registry logs every spawn, that would measure the console instead of the ECS
+	Logger::SetEnabled(false);
+	JobSystem benchmarkJobSystem;
+	jobSystem = &benchmarkJobSystem;
+
+	const std::vector<std::pair<std::string, Benchmark>> benchmarks = {
+		{ "CreateEntity", BenchmarkCreateEntity },
+		{ "AddComponent", BenchmarkAddComponent },
+		{ "AddEntitiesToSystems", BenchmarkAddEntitiesToSystems },
+		{ "GetComponent", BenchmarkGetComponent },
+		{ "MovementSystemUpdate", BenchmarkMovementSystem },
+		{ "RemoveComponent", BenchmarkRemoveComponent },
+		{ "DespawnChurn", BenchmarkDespawnChurn },
+		{ "BinaryLogWrite", BenchmarkBinaryLogWrite },
+		{ "RenderQueueFullSort", BenchmarkRenderQueueFullSort },
+		{ "RenderQueueCoherentSort", BenchmarkRenderQueueCoherentSort }
+	};
+
+	std::vector<BenchmarkResult> results;
+	for (int size: sizes) {
+		for (const auto& benchmark: benchmarks) {
+			BenchmarkResult result{ benchmark.first, size, 0, {} };
+
+			// The first call pays for the cold caches and the first touch of the allocator's pages
+			int warmupOperations = 0;
+			benchmark.second(size, warmupOperations);
+
+			for (int repetition = 0; repetition < repetitions; repetition++) {
+				int operations = 0;
+				result.nanosecsPerOperation.push_back(RunSample(benchmark.second, size, operations));
+				result.operations = operations;
+			}
+			std::vector<double> sorted = result.nanosecsPerOperation;
+			std::sort(sorted.begin(), sorted.end());
+			std::cerr << benchmark.first << " @ " << size << ": " << GetPercentile(sorted, 50) << " ns/op (median)" << std::endl;
+			results.push_back(result);
+		}
+	}
+
+	const std::string json = ToJson(results, repetitions);
+	if (outFilePath.empty()) {
+		std::cout << json;
+	} else {
+		std::ofstream(outFilePath) << json;
+	}
+
+	return 0;
+}
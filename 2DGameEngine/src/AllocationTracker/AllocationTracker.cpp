@@ -0,0 +1,311 @@
+#include "AllocationTracker.h"
+#include "../Logger/Logger.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#include <malloc.h>
+#pragma comment(lib, "dbghelp.lib")
+#else
+#include <execinfo.h>
+#endif
+
+std::atomic<uint64_t> AllocationTracker::totalCount{ 0 };
+std::atomic<uint64_t> AllocationTracker::totalBytes{ 0 };
+std::atomic<uint64_t> AllocationTracker::frameCount{ 0 };
+std::atomic<uint64_t> AllocationTracker::frameBytes{ 0 };
+std::atomic<bool> AllocationTracker::isCapturingCallSites{ true };
+bool AllocationTracker::isExpectingZeroAllocations = false;
+AllocationZoneEntry AllocationTracker::zones[MAX_ZONES];
+AllocationCallSiteEntry AllocationTracker::callSites[MAX_CALL_SITES];
+thread_local bool AllocationTracker::isInsideHook = false;
+
+void AllocationTracker::OnAllocation(size_t size) {
+	totalCount.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	if (isFrameThread) {
+		frameCount.fetch_add(1, std::memory_order_relaxed);
+		frameBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	if (isInsideHook) {
+		return;
+	}
+	isInsideHook = true;
+	RecordZone(size);
+	if (isCapturingCallSites.load(std::memory_order_relaxed)) {
+		RecordCallSite(size);
+	}
+	isInsideHook = false;
+}
+
+void AllocationTracker::RecordZone(size_t size) {
+	const char* name = Profiler::GetCurrentZone();
+	if (!name) {
+		name = "(no zone)";
+	}
+
+	// Open addressing on the name pointer, the zone names are literals or system names that live as long as the program
+	size_t index = (reinterpret_cast<uintptr_t>(name) >> 3) % MAX_ZONES;
+	for (int probe = 0; probe < MAX_ZONES; probe++) {
+		AllocationZoneEntry& entry = zones[index];
+		const char* current = entry.name.load(std::memory_order_acquire);
+		if (current == nullptr) {
+			const char* expected = nullptr;
+			if (entry.name.compare_exchange_strong(expected, name, std::memory_order_acq_rel)) {
+				current = name;
+			} else {
+				current = expected;
+			}
+		}
+		if (current == name) {
+			entry.count.fetch_add(1, std::memory_order_relaxed);
+			entry.bytes.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+		index = (index + 1) % MAX_ZONES;
+	}
+}
+
+void AllocationTracker::RecordCallSite(size_t size) {
+	void* frames[AllocationCallSiteEntry::MAX_FRAMES + 3];
+
+	// Skips the tracker and operator new frames
+	const int skipped = 3;
+#ifdef _WIN32
+	const int numFrames = CaptureStackBackTrace(skipped, AllocationCallSiteEntry::MAX_FRAMES, frames, nullptr);
+	void** callerFrames = frames;
+#else
+	const int numFrames = std::max(backtrace(frames, AllocationCallSiteEntry::MAX_FRAMES + skipped) - skipped, 0);
+	void** callerFrames = frames + skipped;
+#endif
+
+	// FNV-1a over the return addresses, 0 is kept for the empty slots
+	uint64_t key = 14695981039346656037ull;
+	for (int i = 0; i < numFrames; i++) {
+		key = (key ^ reinterpret_cast<uintptr_t>(callerFrames[i])) * 1099511628211ull;
+	}
+	key = std::max<uint64_t>(key, 1);
+
+	size_t index = key % MAX_CALL_SITES;
+	for (int probe = 0; probe < MAX_CALL_SITES; probe++) {
+		AllocationCallSiteEntry& entry = callSites[index];
+		uint64_t current = entry.key.load(std::memory_order_acquire);
+		if (current == 0) {
+			uint64_t expected = 0;
+			if (entry.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+				// Only the thread that claimed the slot writes the frames, the report reads them at the end of the run
+				std::copy(callerFrames, callerFrames + numFrames, entry.frames);
+				entry.numFrames = numFrames;
+				current = key;
+			} else {
+				current = expected;
+			}
+		}
+		if (current == key) {
+			entry.count.fetch_add(1, std::memory_order_relaxed);
+			entry.bytes.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+		index = (index + 1) % MAX_CALL_SITES;
+	}
+}
+
+void AllocationTracker::BeginFrame() {
+	frameCount.store(0, std::memory_order_relaxed);
+	frameBytes.store(0, std::memory_order_relaxed);
+}
+
+FrameAllocations AllocationTracker::EndFrame() {
+	FrameAllocations frame;
+	frame.count = frameCount.load(std::memory_order_relaxed);
+	frame.bytes = frameBytes.load(std::memory_order_relaxed);
+
+	if (isExpectingZeroAllocations && frame.count > 0) {
+		Logger::Err("Steady state frame allocated " + std::to_string(frame.count) + " times (" + std::to_string(frame.bytes) + " bytes)");
+		LogReport();
+		assert(frame.count == 0 && "A steady state frame must not allocate");
+	}
+	return frame;
+}
+
+void AllocationTracker::SetExpectZeroAllocations(bool expect) {
+	isExpectingZeroAllocations = expect;
+}
+
+void AllocationTracker::SetCaptureCallSites(bool capture) {
+	isCapturingCallSites = capture;
+}
+
+uint64_t AllocationTracker::GetTotalCount() {
+	return totalCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::GetTotalBytes() {
+	return totalBytes.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::Reset() {
+	for (auto& entry: zones) {
+		entry.count = 0;
+		entry.bytes = 0;
+	}
+	for (auto& entry: callSites) {
+		entry.count = 0;
+		entry.bytes = 0;
+	}
+}
+
+void AllocationTracker::LogReport(int maxEntries) {
+	// The report allocates, none of it should show up in the tables
+	isInsideHook = true;
+
+	Logger::Log("Allocations: " + std::to_string(GetTotalCount()) + " (" + std::to_string(GetTotalBytes() / 1024) + " KB) in total");
+
+	std::vector<const AllocationZoneEntry*> sortedZones;
+	for (auto& entry: zones) {
+		if (entry.name.load() && entry.count.load() > 0) {
+			sortedZones.push_back(&entry);
+		}
+	}
+	std::sort(sortedZones.begin(), sortedZones.end(), [](const AllocationZoneEntry* a, const AllocationZoneEntry* b) {
+		return a->count.load() > b->count.load();
+	});
+	for (int i = 0; i < std::min<int>(maxEntries, sortedZones.size()); i++) {
+		Logger::Log("  zone " + std::string(sortedZones[i]->name.load()) + ": " + std::to_string(sortedZones[i]->count.load()) +
+			" allocations, " + std::to_string(sortedZones[i]->bytes.load()) + " bytes");
+	}
+
+	std::vector<const AllocationCallSiteEntry*> sortedCallSites;
+	for (auto& entry: callSites) {
+		if (entry.key.load() != 0 && entry.count.load() > 0) {
+			sortedCallSites.push_back(&entry);
+		}
+	}
+	std::sort(sortedCallSites.begin(), sortedCallSites.end(), [](const AllocationCallSiteEntry* a, const AllocationCallSiteEntry* b) {
+		return a->count.load() > b->count.load();
+	});
+
+#ifdef _WIN32
+	HANDLE process = GetCurrentProcess();
+	SymInitialize(process, nullptr, TRUE);
+#endif
+	for (int i = 0; i < std::min<int>(maxEntries, sortedCallSites.size()); i++) {
+		const AllocationCallSiteEntry& site = *sortedCallSites[i];
+		Logger::Log("  call site #" + std::to_string(i + 1) + ": " + std::to_string(site.count.load()) + " allocations, " +
+			std::to_string(site.bytes.load()) + " bytes");
+#ifdef _WIN32
+		char symbolStorage[sizeof(SYMBOL_INFO) + 256];
+		SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(symbolStorage);
+		symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		symbol->MaxNameLen = 255;
+		for (int frame = 0; frame < site.numFrames; frame++) {
+			DWORD64 address = reinterpret_cast<DWORD64>(site.frames[frame]);
+			if (SymFromAddr(process, address, nullptr, symbol)) {
+				Logger::Log("      " + std::string(symbol->Name));
+			}
+		}
+#else
+		char** symbols = backtrace_symbols(site.frames, site.numFrames);
+		for (int frame = 0; symbols && frame < site.numFrames; frame++) {
+			Logger::Log("      " + std::string(symbols[frame]));
+		}
+		free(symbols);
+#endif
+	}
+#ifdef _WIN32
+	SymCleanup(process);
+#endif
+
+	isInsideHook = false;
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKER
+// The plain, array and aligned forms are replaced, the nothrow overloads call them
+// Aligned allocations (alignas above 16, like ChunkLocalValue) don't go through the plain forms
+static void* AllocateAligned(size_t size, size_t alignment) {
+	size = size ? size : 1;
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, std::max(alignment, sizeof(void*)), size) != 0) {
+		return nullptr;
+	}
+	return memory;
+#endif
+}
+
+// _aligned_malloc memory has to go back through _aligned_free
+static void FreeAligned(void* memory) {
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void* operator new(size_t size) {
+	AllocationTracker::OnAllocation(size);
+	if (void* memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	AllocationTracker::OnAllocation(size);
+	if (void* memory = AllocateAligned(size, static_cast<size_t>(alignment))) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+	FreeAligned(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+	FreeAligned(memory);
+}
+#endif
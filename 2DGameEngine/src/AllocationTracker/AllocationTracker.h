@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Counts the heap allocations of the whole program by replacing the global operator new
+// The hook is only compiled in when ENABLE_ALLOCATION_TRACKER is defined, without it every count stays at zero
+// Allocations are attributed to the innermost profiler zone of the thread (systems run in a zone named after them)
+// The zones come from PROFILE_ZONE, so without ENABLE_PROFILER every allocation lands in "(no zone)"
+// The frame counts only include the threads that run the frame (the main thread and the job workers), the logger,
+// metrics and flight recorder threads allocate on their own schedule and would make every frame look dirty
+
+struct FrameAllocations {
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+};
+
+// Fixed size tables, the hook can't allocate to grow them
+struct AllocationZoneEntry {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+};
+
+struct AllocationCallSiteEntry {
+	static const int MAX_FRAMES = 10;
+
+	std::atomic<uint64_t> key{ 0 };
+	void* frames[MAX_FRAMES] = {};
+	int numFrames = 0;
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+};
+
+class AllocationTracker {
+private:
+	static const int MAX_ZONES = 256;
+	static const int MAX_CALL_SITES = 1024;
+
+	static std::atomic<uint64_t> totalCount;
+	static std::atomic<uint64_t> totalBytes;
+	static std::atomic<uint64_t> frameCount;
+	static std::atomic<uint64_t> frameBytes;
+	static std::atomic<bool> isCapturingCallSites;
+	static bool isExpectingZeroAllocations;
+
+	static AllocationZoneEntry zones[MAX_ZONES];
+	static AllocationCallSiteEntry callSites[MAX_CALL_SITES];
+
+	// Set while the tracker itself runs on this thread, so the stack capture can't recurse into the hook
+	static thread_local bool isInsideHook;
+
+	// Inline so the job system can mark its workers without linking the tracker
+	static inline thread_local bool isFrameThread = false;
+
+	static void RecordZone(size_t size);
+	static void RecordCallSite(size_t size);
+public:
+	static constexpr bool IsEnabled() {
+#ifdef ENABLE_ALLOCATION_TRACKER
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// Called by the operator new replacement
+	static void OnAllocation(size_t size);
+
+	// Allocations of the calling thread count towards the frame, called by the main thread and the job workers
+	static void SetFrameThread(bool isFrameThread) {
+		AllocationTracker::isFrameThread = isFrameThread;
+	}
+
+	// Frame boundaries, EndFrame() returns what the frame threads allocated
+	static void BeginFrame();
+	static FrameAllocations EndFrame();
+
+	// In a steady state frame the engine should not touch the heap, EndFrame() asserts when it does
+	static void SetExpectZeroAllocations(bool expect);
+
+	// Capturing the call stack of every allocation is slow, it can be turned off to only keep the counts
+	static void SetCaptureCallSites(bool capture);
+
+	static uint64_t GetTotalCount();
+	static uint64_t GetTotalBytes();
+
+	// Forgets the zones and call sites recorded so far
+	static void Reset();
+
+	// Logs the zones and the call sites that allocated the most since the last Reset()
+	static void LogReport(int maxEntries = 10);
+};
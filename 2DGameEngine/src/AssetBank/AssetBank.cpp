@@ -1,5 +1,6 @@
 #include "AssetBank.h"
 #include "../Logger/Logger.h"
+#include "../Metrics/Metrics.h"
 #include "SDL_image.h"
 
 AssetBank::AssetBank() {
@@ -18,6 +19,7 @@ void AssetBank::ClearAssets() {
 		SDL_DestroyTexture(texture.second);
 	}
 	textures.clear();
+	generation++;
 }
 
 void AssetBank::AddTexture(SDL_Renderer* renderer, const std::string& assetId, const std::string& filepath) {
@@ -27,11 +29,42 @@ void AssetBank::AddTexture(SDL_Renderer* renderer, const std::string& assetId, c
 
 	// Add the texture to the map
 	textures.emplace(assetId, texture);
+	generation++;
 
-	Logger::Log("New texture added to the asset bank with id: " + assetId);
+	LOG_INF(LOG_CATEGORY_ASSETS, "New texture added to the asset bank with id: " + assetId);
 }
 
 // We previously marked this method as const but since we are trying to get a map value using brackets we had to remove it, C++ stuff
+// Using find also stops a missing id from inserting a null texture, and tells the hits from the misses
 SDL_Texture* AssetBank::GetTexture(const std::string& assetId) {
-	return textures[assetId];
+	static MetricCounter& hitsMetric = Metrics::GetCounter("assets.texture_hits");
+	static MetricCounter& missesMetric = Metrics::GetCounter("assets.texture_misses");
+
+	auto texture = textures.find(assetId);
+	if (texture == textures.end() || !texture->second) {
+		missesMetric.Add();
+		return nullptr;
+	}
+	hitsMetric.Add();
+	return texture->second;
+}
+
+int AssetBank::GetNumTextures() const {
+	return static_cast<int>(textures.size());
+}
+
+int AssetBank::GetGeneration() const {
+	return generation;
+}
+
+size_t AssetBank::GetTextureMemoryUsage() const {
+	size_t bytes = 0;
+	for (auto& texture: textures) {
+		int width = 0;
+		int height = 0;
+		if (texture.second && SDL_QueryTexture(texture.second, nullptr, nullptr, &width, &height) == 0) {
+			bytes += static_cast<size_t>(width) * height * 4;
+		}
+	}
+	return bytes;
 }
\ No newline at end of file
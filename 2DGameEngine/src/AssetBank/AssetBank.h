@@ -6,6 +6,9 @@
 class AssetBank {
 private:
 	std::map<std::string, SDL_Texture*> textures;
+
+	// Bumped whenever a texture is added or the bank is cleared, so the pointers cached by the sprites can be checked
+	int generation = 0;
 public:
 	AssetBank();
 	~AssetBank();
@@ -13,4 +16,10 @@ public:
 	void ClearAssets();
 	void AddTexture(SDL_Renderer* renderer, const std::string& assetId, const std::string& filePath);
 	SDL_Texture* GetTexture(const std::string& assetId);
+
+	int GetNumTextures() const;
+	int GetGeneration() const;
+
+	// Estimated from the texture sizes, 4 bytes per pixel
+	size_t GetTextureMemoryUsage() const;
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+// Numeric command line arguments are checked here, a bad value prints the usage instead of throwing out of main
+// Shared by the game and the benchmark tools
+template <typename T>
+bool ParseNumber(const std::string& flag, const char* text, T& value, const char* usage) {
+	char* end = nullptr;
+	errno = 0;
+	bool isValid;
+	if constexpr (std::is_floating_point_v<T>) {
+		const double number = std::strtod(text, &end);
+		isValid = std::isfinite(number);
+		value = static_cast<T>(number);
+	} else if constexpr (std::is_signed_v<T>) {
+		const long long number = std::strtoll(text, &end, 10);
+		isValid = number >= std::numeric_limits<T>::min() && number <= std::numeric_limits<T>::max();
+		value = static_cast<T>(number);
+	} else {
+		const unsigned long long number = std::strtoull(text, &end, 10);
+		isValid = text[0] != '-' && number <= std::numeric_limits<T>::max();
+		value = static_cast<T>(number);
+	}
+	if (!isValid || errno != 0 || end == text || *end != '\0') {
+		std::cerr << "Invalid value for " << flag << ": " << text << std::endl << usage;
+		return false;
+	}
+	return true;
+}
@@ -3,15 +3,29 @@
 #include <glm/glm.hpp>
 #include <string>
 
+struct SDL_Texture;
+
+// Layers for SpriteComponent::zIndex, inside a layer the sprites are only ordered by their bottom edge per texture
+enum SpriteLayer{LAYER_TILEMAP, LAYER_GROUND, LAYER_AIR, LAYER_UI};
+
 struct SpriteComponent {
 	std::string assetId;
 	int width;
 	int height;
+	// Draw order, lower layers are drawn first (see SpriteLayer)
+	int zIndex;
+
+	// Resolved from assetId by the render system, and again only when the asset bank generation changes
+	SDL_Texture* texture;
+	int textureGeneration;
 
 	// we always need to add a default value for the components we create
-	SpriteComponent(std::string assetId = "",int width = 0, int height = 0) {
+	SpriteComponent(std::string assetId = "",int width = 0, int height = 0, int zIndex = LAYER_GROUND) {
 		this->assetId = assetId;
 		this->width = width;
 		this->height = height;
+		this->zIndex = zIndex;
+		this->texture = nullptr;
+		this->textureGeneration = -1;
 	}
 };
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include <glm/glm.hpp>
 struct TransformComponent {
+	// Keep the previous frame transform so other systems can read it while MovementSystem writes, and for render interpolation
+	static constexpr bool isDoubleBuffered = true;
+
 	glm::vec2 position;
 	glm::vec2 scale;
 	double rotation;
@@ -1,25 +1,68 @@
 #include "ECS.h"
 #include "../Logger/Logger.h"
+#include "../Metrics/Metrics.h"
+#include <algorithm>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
 
-int IComponent::nextId = 1;
+std::atomic<int> IComponent::nextId{ 1 };
+
+thread_local System* System::currentSystem = nullptr;
+
+std::string GetReadableTypeName(const std::type_info& typeInfo) {
+#ifdef __GNUC__
+	// GCC and clang return mangled names
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(typeInfo.name(), nullptr, nullptr, &status);
+	std::string name = status == 0 ? demangled : typeInfo.name();
+	std::free(demangled);
+	return name;
+#else
+	// MSVC returns "class Name"
+	std::string name = typeInfo.name();
+	const std::string prefix = "class ";
+	if (name.compare(0, prefix.size(), prefix) == 0) {
+		name = name.substr(prefix.size());
+	}
+	return name;
+#endif
+}
 
 int Entity::GetId() const {
 	return id;
 }
 
+void Entity::Kill() {
+	registry->KillEntity(*this);
+}
+
 void System::AddEntityToSystem(Entity entity){
+	const int entityId = entity.GetId();
+	if (entityId >= static_cast<int>(entityIndices.size())) {
+		entityIndices.resize(entityId + 1, -1);
+	}
+	if (entityIndices[entityId] >= 0) {
+		return;
+	}
+	entityIndices[entityId] = static_cast<int>(entities.size());
 	entities.push_back(entity);
 }
 
 void  System::RemoveEntity(Entity entity){
-	entities.erase(std::remove_if(entities.begin(), entities.end(), 
-		[&entity](Entity other){
-			//return entity.GetId() == other.GetId();
-			// after the implementation of operator overloading we can compare elements
-			// behind the scenes we are comparing ids
-			return entity == other;
-		}
-	),entities.end());
+	const int entityId = entity.GetId();
+	if (entityId >= static_cast<int>(entityIndices.size()) || entityIndices[entityId] < 0) {
+		return;
+	}
+
+	// The last entity takes the place of the removed one, the order of the entities isn't kept
+	const int index = entityIndices[entityId];
+	const Entity last = entities.back();
+	entities[index] = last;
+	entityIndices[last.GetId()] = index;
+	entities.pop_back();
+	entityIndices[entityId] = -1;
 }
 
 std::vector<Entity>  System::GetSystemEntities() const{
@@ -30,27 +73,143 @@ const Signature& System::GetComponentSignature() const{
 	return componentSignature;
 }
 
+int System::GetNumEntities() const {
+	return static_cast<int>(entities.size());
+}
+
+size_t System::GetMemoryUsage() const {
+	return entities.capacity() * sizeof(Entity) + entityIndices.capacity() * sizeof(int);
+}
+
+const std::string& System::GetName() const {
+	return name;
+}
+
+void System::SetName(const std::string& name) {
+	this->name = name;
+}
+
+void System::RecordUpdateTime(double millisecs) {
+	lastUpdateMillisecs = millisecs;
+	totalUpdateMillisecs += millisecs;
+	numUpdates++;
+}
+
+double System::GetLastUpdateMillisecs() const {
+	return lastUpdateMillisecs;
+}
+
+double System::GetAverageUpdateMillisecs() const {
+	return numUpdates > 0 ? totalUpdateMillisecs / numUpdates : 0.0;
+}
+
+uint64_t System::GetNumUpdates() const {
+	return numUpdates;
+}
+
+void System::ResetUpdateTimes() {
+	lastUpdateMillisecs = 0.0;
+	totalUpdateMillisecs = 0.0;
+	numUpdates = 0;
+}
+
+Signature System::GetReadSignature() const {
+	return componentSignature | readSignature;
+}
+
+const Signature& System::GetWriteSignature() const {
+	return writeSignature;
+}
+
+bool System::ConflictsWith(const System& other) const {
+	// Two systems can't run together if one of them writes something the other one touches
+	bool writesWhatOtherUses = (writeSignature & (other.GetReadSignature() | other.writeSignature)).any();
+	bool usesWhatOtherWrites = (GetReadSignature() & other.writeSignature).any();
+	return writesWhatOtherUses || usesWhatOtherWrites;
+}
+
+void System::CheckComponentAccess(int componentId, bool isWrite) {
+	if (writeSignature.test(componentId)) {
+		return;
+	}
+	if (isWrite) {
+		undeclaredWrites.fetch_or(1u << componentId, std::memory_order_relaxed);
+	} else if (!GetReadSignature().test(componentId)) {
+		undeclaredAccesses.fetch_or(1u << componentId, std::memory_order_relaxed);
+	}
+}
+
+Signature System::TakeUndeclaredAccesses() {
+	return Signature(undeclaredAccesses.exchange(0, std::memory_order_relaxed));
+}
+
+Signature System::TakeUndeclaredWrites() {
+	return Signature(undeclaredWrites.exchange(0, std::memory_order_relaxed));
+}
+
 Entity Registry::CreateEntity() {
-	int entityId = numEntities++;
+	int entityId;
+
+	if (freeIds.empty()) {
+		// No ids to reuse, so we need a new one
+		entityId = numEntities++;
+		if (entityId >= entityComponentSignatures.size()){
+			entityComponentSignatures.resize(entityId + 1);
+		}
+	} else {
+		// Reuse an id from a previously killed entity
+		entityId = freeIds.front();
+		freeIds.pop_front();
+	}
+
 	Entity entity(entityId);
 	entity.registry = this; // this is referring to the registry class, like in C#
 	entitiesToBeAdded.insert(entity);
 
-	if (entityId >= entityComponentSignatures.size()){
-		entityComponentSignatures.resize(entityId + 1);
-	}
+	static MetricCounter& createdMetric = Metrics::GetCounter("ecs.entities_created");
+	createdMetric.Add();
 
-	Logger::Log("Entity created with id = " + std::to_string(entityId));
+	LOG_BIN(LOG_DEBUG, LOG_CATEGORY_ECS, "Entity created with id = {}", entityId);
 
 	return entity;
 }
 
+void Registry::KillEntity(Entity entity) {
+	entitiesTobeKilled.insert(entity);
+}
+
+void Registry::SwapBuffers() {
+	for (auto& componentPool: componentPools) {
+		if (componentPool) {
+			componentPool->SwapBuffers();
+		}
+	}
+}
+
 void Registry::Update() {
+	PROFILE_ZONE("Registry::Update");
+
 	for (auto entity: entitiesToBeAdded){
 		AddEntityToSystems(entity);
 	}
 	entitiesToBeAdded.clear();
 
+	// Remove the entities that are waiting to be killed from the systems and make their ids available again
+	static MetricCounter& killedMetric = Metrics::GetCounter("ecs.entities_killed");
+	killedMetric.Add(entitiesTobeKilled.size());
+	for (auto entity: entitiesTobeKilled) {
+		RemoveEntityFromSystems(entity);
+		entityComponentSignatures[entity.GetId()].reset();
+		freeIds.push_back(entity.GetId());
+	}
+	entitiesTobeKilled.clear();
+
+	// Transient components only last one frame, clearing a pool just rewinds its counter
+	for (auto& transientPool: transientPools) {
+		if (transientPool) {
+			transientPool->Clear();
+		}
+	}
 }
 
 
@@ -68,4 +227,99 @@ void Registry::AddEntityToSystems(Entity entity) {
 			system.second->AddEntityToSystem(entity);
 		}
 	}
+}
+
+void Registry::RemoveEntityFromSystems(Entity entity) {
+	for (auto& system: systems) {
+		system.second->RemoveEntity(entity);
+	}
+}
+
+std::vector<System*> Registry::GetSystems() const {
+	std::vector<System*> result;
+	for (auto& system: systems) {
+		result.push_back(system.second.get());
+	}
+	std::sort(result.begin(), result.end(), [](const System* a, const System* b) {
+		return a->GetName() < b->GetName();
+	});
+	return result;
+}
+
+int Registry::GetNumComponentPools() const {
+	return static_cast<int>(componentPools.size());
+}
+
+const IPool* Registry::GetComponentPool(int componentId) const {
+	return componentPools[componentId].get();
+}
+
+int Registry::GetNumEntities() const {
+	return numEntities - static_cast<int>(freeIds.size());
+}
+
+RegistryMemoryStats Registry::GetMemoryStats() const {
+	RegistryMemoryStats stats;
+
+	// Killed entities have their signature reset, so counting the bits gives the live components of every pool
+	std::vector<int> liveCounts(componentPools.size(), 0);
+	for (const auto& signature: entityComponentSignatures) {
+		if (signature.none()) {
+			continue;
+		}
+		for (size_t componentId = 0; componentId < liveCounts.size(); componentId++) {
+			if (signature.test(componentId)) {
+				liveCounts[componentId]++;
+			}
+		}
+	}
+
+	for (size_t componentId = 0; componentId < componentPools.size(); componentId++) {
+		const auto& pool = componentPools[componentId];
+		if (!pool) {
+			continue;
+		}
+		PoolMemoryStats poolStats;
+		poolStats.componentId = static_cast<int>(componentId);
+		poolStats.componentName = pool->GetComponentName();
+		poolStats.capacity = pool->GetCapacity();
+		poolStats.size = pool->GetSize();
+		poolStats.liveCount = liveCounts[componentId];
+		poolStats.holes = std::max(poolStats.size - poolStats.liveCount, 0);
+		poolStats.bytes = pool->GetMemoryUsage();
+		stats.poolBytes += poolStats.bytes;
+		stats.pools.push_back(poolStats);
+	}
+
+	for (const auto& transientPool: transientPools) {
+		if (transientPool) {
+			stats.transientPoolBytes += transientPool->GetMemoryUsage();
+		}
+	}
+	for (const auto& system: systems) {
+		stats.systemBytes += sizeof(*system.second) + system.second->GetMemoryUsage();
+	}
+	stats.signatureBytes = entityComponentSignatures.capacity() * sizeof(Signature);
+	stats.freeIdBytes = freeIds.size() * sizeof(int);
+
+	stats.totalBytes = stats.poolBytes + stats.transientPoolBytes + stats.signatureBytes + stats.systemBytes + stats.freeIdBytes;
+	stats.numEntities = GetNumEntities();
+	stats.bytesPerEntity = stats.numEntities > 0 ? static_cast<double>(stats.totalBytes) / stats.numEntities : 0.0;
+
+	return stats;
+}
+
+void Registry::LogMemoryStats() const {
+	const RegistryMemoryStats stats = GetMemoryStats();
+
+	LOG_INF(LOG_CATEGORY_ECS, "Registry memory: " + std::to_string(stats.totalBytes / 1024) + " KB for " + std::to_string(stats.numEntities) +
+		" entities (" + std::to_string(static_cast<int>(stats.bytesPerEntity)) + " bytes per entity)");
+	for (const auto& pool: stats.pools) {
+		LOG_INF(LOG_CATEGORY_ECS, "  " + pool.componentName + ": " + std::to_string(pool.liveCount) + " live / " + std::to_string(pool.size) +
+			" slots / " + std::to_string(pool.capacity) + " capacity, " + std::to_string(pool.holes) + " holes, " +
+			std::to_string(pool.bytes / 1024) + " KB");
+	}
+	LOG_INF(LOG_CATEGORY_ECS, "  transient pools: " + std::to_string(stats.transientPoolBytes / 1024) + " KB, signatures: " +
+		std::to_string(stats.signatureBytes / 1024) + " KB, systems: " + std::to_string(stats.systemBytes / 1024) +
+		" KB, free ids: " + std::to_string(stats.freeIdBytes / 1024) + " KB");
 }
\ No newline at end of file
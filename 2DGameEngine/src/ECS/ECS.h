@@ -1,15 +1,24 @@
 #pragma once
+#include <atomic>
 #include <bitset>
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
+#include <string>
 #include <set>
+#include <deque>
 #include <memory>
+#include <type_traits>
 #include "../Logger/Logger.h"
+#include "../Logger/BinaryLog.h"
+#include "../JobSystem/JobSystem.h"
 
 const unsigned int MAX_COMPONENTS = 32;
 typedef std::bitset<MAX_COMPONENTS> Signature;
 
+// Class name without the compiler decorations, used to name the systems in reports
+std::string GetReadableTypeName(const std::type_info& typeInfo);
+
 class Entity {
 private:
 	int id;
@@ -18,6 +27,7 @@ public:
 	Entity(const Entity& entity) = default;
 
 	int GetId() const;
+	void Kill();
 
 	// Operation overloading
 	Entity& operator = (const Entity& other) = default;
@@ -34,11 +44,16 @@ public:
 	template <typename TComponent> void RemoveComponent();
 	template <typename TComponent> bool HasComponent() const;
 	template <typename TComponent> TComponent& GetComponent() const;
+	template <typename TComponent> const TComponent& ReadComponent() const;
+	template <typename TComponent> const TComponent& GetPreviousComponent() const;
+	template <typename TComponent, typename ...TArgs> void AddTransientComponent(TArgs&& ...args);
 };
 
 struct IComponent {
 protected:
-	static int nextId;
+	// Shared by every registry, component ids describe types not worlds
+	// Atomic because several worlds can register their first component of a type at the same time
+	static std::atomic<int> nextId;
 };
 
 template <typename T>
@@ -56,32 +71,108 @@ class System {
 private:
 	Signature componentSignature;
 	std::vector<Entity> entities;
+
+	// Position of every entity id in entities, -1 when the entity isn't in the system, so removing one is a swap and pop
+	std::vector<int> entityIndices;
+
+	// Components the system touches, used by the scheduler to know which systems can run at the same time
+	// Required components are always considered as read
+	Signature readSignature;
+	Signature writeSignature;
+
+	// Components accessed without being declared, and components written without WritesComponent()
+	// Only filled when the scheduler runs in debug mode
+	std::atomic<uint32_t> undeclaredAccesses{ 0 };
+	std::atomic<uint32_t> undeclaredWrites{ 0 };
+
+	std::string name;
+
+	// Time spent in the system updates, filled by the scheduler
+	double lastUpdateMillisecs = 0.0;
+	double totalUpdateMillisecs = 0.0;
+	uint64_t numUpdates = 0;
 public:
 	System() = default;
 	~System() = default;
 
+	// The system being executed by the scheduler on the current thread (only set in debug mode)
+	static thread_local System* currentSystem;
+
 	void AddEntityToSystem(Entity entity);
 	void RemoveEntity(Entity entity);
 	std::vector<Entity> GetSystemEntities() const;
 	const Signature& GetComponentSignature() const;
+	int GetNumEntities() const;
+
+	const std::string& GetName() const;
+	void SetName(const std::string& name);
+
+	void RecordUpdateTime(double millisecs);
+	double GetLastUpdateMillisecs() const;
+	double GetAverageUpdateMillisecs() const;
+	uint64_t GetNumUpdates() const;
+	void ResetUpdateTimes();
+
+	Signature GetReadSignature() const;
+	const Signature& GetWriteSignature() const;
+	bool ConflictsWith(const System& other) const;
+
+	// Bytes held by the entity list and its index
+	size_t GetMemoryUsage() const;
+
+	// GetComponent() counts as a write, ReadComponent() as a read
+	void CheckComponentAccess(int componentId, bool isWrite);
+	Signature TakeUndeclaredAccesses();
+	Signature TakeUndeclaredWrites();
 
 	// Defines the component type that entities must have to be considered by the system
 	template <typename TComponent> void RequiredComponent();
+
+	// Runs func(entity) for every system entity, split in chunks of grainSize across the job system workers (0 picks a grain size)
+	template <typename TFunc> void ParallelEach(JobSystem& jobSystem, TFunc func, int grainSize = 0);
+
+	// Same as ParallelEach but func(entity, local) accumulates into a per chunk value, the locals are combined with reduce at the end
+	template <typename T, typename TFunc, typename TReduce> T ParallelEachReduce(JobSystem& jobSystem, T identity, TFunc func, TReduce reduce, int grainSize = 0);
+
+	// Declares the components the system reads or writes besides the required ones
+	template <typename TComponent> void ReadsComponent();
+	template <typename TComponent> void WritesComponent();
 };
 
 
+// Components opt in to double buffering by declaring: static constexpr bool isDoubleBuffered = true;
+// Their pool keeps a copy of the previous frame that can be read from any thread while the systems write the current one
+template <typename T, typename = void>
+struct IsDoubleBuffered : std::false_type {};
+
+template <typename T>
+struct IsDoubleBuffered<T, std::void_t<decltype(T::isDoubleBuffered)>> : std::bool_constant<T::isDoubleBuffered> {};
+
 class IPool {
 public:
 	virtual ~IPool() {}
+	virtual void SwapBuffers() {}
+
+	// Describes the pool without knowing its component type, for tools and reports
+	virtual std::string GetComponentName() const = 0;
+	virtual int GetSize() const = 0;
+	virtual int GetCapacity() const = 0;
+	virtual size_t GetMemoryUsage() const = 0;
 };
 
 template <typename T>
 class Pool : public IPool {
 private:
 	std::vector<T> data;
+
+	// Snapshot of data taken at the last frame boundary, only used by double buffered components
+	std::vector<T> previousData;
 public:
 	Pool(int size = 100) {
 		data.resize(size);
+		if constexpr (IsDoubleBuffered<T>::value) {
+			previousData.resize(size);
+		}
 	}
 
 	virtual ~Pool() = default;
@@ -89,20 +180,38 @@ public:
 	bool isEmpty() const {
 		return data.empty();
 	}
-	int GetSize() {
+	int GetSize() const override {
 		return data.size();
 	}
+	int GetCapacity() const override {
+		return data.capacity();
+	}
+	std::string GetComponentName() const override {
+		return GetReadableTypeName(typeid(T));
+	}
+	size_t GetMemoryUsage() const override {
+		return (data.capacity() + previousData.capacity()) * sizeof(T);
+	}
 	void Resize(int size) {
 		data.resize(size);
+		if constexpr (IsDoubleBuffered<T>::value) {
+			previousData.resize(size);
+		}
 	}
 	void Clear() {
 		data.clear();
+		previousData.clear();
 	}
 	void Add(T object) {
 		data.push_back(object);
 	}
 	void Set(int index, T object) {
 		data[index] = object;
+
+		// A new component has no history yet, so its previous state is the same as the current one
+		if constexpr (IsDoubleBuffered<T>::value) {
+			previousData[index] = object;
+		}
 	}
 	T& Get(int index) {
 		//return static_cast<T&>(data[index]);
@@ -113,6 +222,102 @@ public:
 	T& operator [] (unsigned int index) {
 		return data[index];
 	}
+	const T& GetPrevious(int index) const {
+		return previousData[index];
+	}
+	void SwapBuffers() override {
+		// The vectors keep their capacity, so this is a plain copy without allocations
+		if constexpr (IsDoubleBuffered<T>::value) {
+			previousData = data;
+		}
+	}
+};
+
+
+// Transient components are one-frame messages (hit, spawned, entered trigger...)
+// They are not part of the entity signature, they only live until the end of the current Registry::Update()
+class ITransientPool {
+public:
+	virtual ~ITransientPool() {}
+	virtual void Clear() = 0;
+	virtual size_t GetMemoryUsage() const = 0;
+};
+
+template <typename T>
+struct TransientEntry {
+	Entity entity;
+	T component;
+};
+
+template <typename T>
+class TransientPool : public ITransientPool {
+	// Clear() only rewinds the counter, so the slots must not need a destructor call
+	static_assert(std::is_trivially_destructible<T>::value, "Transient components must be trivially destructible");
+private:
+	// Entries are appended linearly and the storage is reused frame after frame, so no allocation happens once it has grown
+	std::vector<TransientEntry<T>> data;
+	int count = 0;
+public:
+	TransientPool(int capacity = 64) {
+		data.reserve(capacity);
+	}
+
+	virtual ~TransientPool() = default;
+
+	bool isEmpty() const {
+		return count == 0;
+	}
+	int GetSize() const {
+		return count;
+	}
+	int GetCapacity() const {
+		return data.capacity();
+	}
+	size_t GetMemoryUsage() const override {
+		return data.capacity() * sizeof(TransientEntry<T>);
+	}
+	void Add(Entity entity, const T& object) {
+		if (count < data.size()) {
+			data[count] = TransientEntry<T>{ entity, object };
+		} else {
+			data.push_back(TransientEntry<T>{ entity, object });
+		}
+		count++;
+	}
+	void Clear() override {
+		count = 0;
+	}
+	TransientEntry<T>& operator [] (unsigned int index) {
+		return data[index];
+	}
+
+	// Allows range-based for loops over the entries emitted this frame
+	TransientEntry<T>* begin() { return data.data(); }
+	TransientEntry<T>* end() { return data.data() + count; }
+};
+
+
+// Memory used by one component pool, the pools are indexed by entity id so every slot without a live component is a hole
+struct PoolMemoryStats {
+	int componentId = 0;
+	std::string componentName;
+	int capacity = 0;
+	int size = 0;
+	int liveCount = 0;
+	int holes = 0;
+	size_t bytes = 0;
+};
+
+struct RegistryMemoryStats {
+	std::vector<PoolMemoryStats> pools;
+	size_t poolBytes = 0;
+	size_t transientPoolBytes = 0;
+	size_t signatureBytes = 0;
+	size_t systemBytes = 0;
+	size_t freeIdBytes = 0;
+	size_t totalBytes = 0;
+	int numEntities = 0;
+	double bytesPerEntity = 0.0;
 };
 
 
@@ -122,7 +327,11 @@ private:
 	std::set<Entity> entitiesToBeAdded;
 	std::set<Entity> entitiesTobeKilled;
 
+	// Ids of killed entities, reused by CreateEntity() before growing numEntities
+	std::deque<int> freeIds;
+
 	std::vector<std::shared_ptr<IPool>> componentPools;
+	std::vector<std::shared_ptr<ITransientPool>> transientPools;
 
 	std::vector<Signature> entityComponentSignatures;
 	std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
@@ -130,10 +339,15 @@ public:
 	Registry() = default;
 
 	// Registry update() finally processes the entities that are waiting to be added/killed
+	// and clears the transient components emitted during the frame
 	void Update();
 
+	// Snapshots the double buffered components, called at the frame boundary before the systems run
+	void SwapBuffers();
+
 	// Entity management
 	Entity CreateEntity();
+	void KillEntity(Entity entity);
 
 	// Component management 
 	template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
@@ -141,14 +355,37 @@ public:
 	template <typename TComponent> bool HasComponent(Entity entity) const;
 	template <typename TComponent> TComponent& GetComponent (Entity entity) const;
 
+	// Same component without write access, what systems use for the components they only declared as read
+	template <typename TComponent> const TComponent& ReadComponent(Entity entity) const;
+
+	// Previous frame state of a double buffered component, safe to read while other systems write the current one
+	template <typename TComponent> const TComponent& GetPreviousComponent(Entity entity) const;
+
+	// Transient component management
+	template <typename TComponent, typename ...TArgs> void AddTransientComponent(Entity entity, TArgs&& ...args);
+	template <typename TComponent> TransientPool<TComponent>& GetTransientComponents();
+
 	// System management
 	template <typename TSystem, typename ...TArgs> void AddSystem(TArgs&& ...args);
 	template <typename TSystem> void RemoveSystem();
 	template <typename TSystem> bool HasSystem() const;
 	template <typename TSystem> TSystem& GetSystem() const;
 
+	// Every system sorted by name, mostly for reports and tools
+	std::vector<System*> GetSystems() const;
+
+	// Component pools indexed by component id, some ids may not have a pool (nullptr)
+	int GetNumComponentPools() const;
+	const IPool* GetComponentPool(int componentId) const;
+	int GetNumEntities() const;
+
+	// Walks every pool and entity signature, meant for reports rather than every frame
+	RegistryMemoryStats GetMemoryStats() const;
+	void LogMemoryStats() const;
+
 	// Checks the component signature of an entity and add the entity to the systems that are interested in it
 	void AddEntityToSystems(Entity entity); 
+	void RemoveEntityFromSystems(Entity entity);
 	
 };
 
@@ -160,6 +397,47 @@ void System::RequiredComponent() {
 	componentSignature.set(componentId);
 }
 
+template <typename TFunc>
+void System::ParallelEach(JobSystem& jobSystem, TFunc func, int grainSize) {
+	// The chunks run on other threads, they have to be checked against this system too
+	System* owner = currentSystem;
+
+	jobSystem.ParallelFor(static_cast<int>(entities.size()), grainSize, [this, owner, &func](int begin, int end) {
+		System* previousSystem = currentSystem;
+		currentSystem = owner;
+		for (int i = begin; i < end; i++) {
+			func(entities[i]);
+		}
+		currentSystem = previousSystem;
+	});
+}
+
+template <typename T, typename TFunc, typename TReduce>
+T System::ParallelEachReduce(JobSystem& jobSystem, T identity, TFunc func, TReduce reduce, int grainSize) {
+	System* owner = currentSystem;
+
+	return jobSystem.ParallelReduce(static_cast<int>(entities.size()), grainSize, identity, [this, owner, &func](int begin, int end, T& local) {
+		System* previousSystem = currentSystem;
+		currentSystem = owner;
+		for (int i = begin; i < end; i++) {
+			func(entities[i], local);
+		}
+		currentSystem = previousSystem;
+	}, reduce);
+}
+
+template <typename TComponent>
+void System::ReadsComponent() {
+	const auto componentId = Component<TComponent>::GetId();
+	readSignature.set(componentId);
+}
+
+template <typename TComponent>
+void System::WritesComponent() {
+	const auto componentId = Component<TComponent>::GetId();
+	writeSignature.set(componentId);
+}
+
 template<typename TComponent, typename ...TArgs>
 void Registry::AddComponent(Entity entity, TArgs && ...args) {
 	const auto componentId = Component<TComponent>::GetId();
@@ -193,7 +471,7 @@ void Registry::AddComponent(Entity entity, TArgs && ...args) {
 	// Finally, change the component signature of the entity and set the component id on the bitset to 1
 	entityComponentSignatures[entityId].set(componentId);
 
-	Logger::Log("Component id: " + std::to_string(componentId) + " was added to entity id: " + std::to_string(entityId));
+	LOG_BIN(LOG_DEBUG, LOG_CATEGORY_ECS, "Component id: {} was added to entity id: {}", componentId, entityId);
 }
 
 template<typename TComponent>
@@ -203,7 +481,7 @@ void Registry::RemoveComponent(Entity entity) {
 
 	entityComponentSignatures[entityId].set(componentId, false);
 
-	Logger::Log("Component id: " + std::to_string(componentId) + " was removed from entity id: " + std::to_string(entityId));
+	LOG_BIN(LOG_DEBUG, LOG_CATEGORY_ECS, "Component id: {} was removed from entity id: {}", componentId, entityId);
 }
 
 template<typename TComponent>
@@ -218,15 +496,67 @@ template<typename TComponent>
 TComponent& Registry::GetComponent(Entity entity) const {
 	const auto componentId = Component<TComponent>::GetId();
 	const auto entityId = entity.GetId();
-	auto componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+
+	if (System::currentSystem) {
+		System::currentSystem->CheckComponentAccess(componentId, true);
+	}
+
+	// Raw pointer on purpose, copying the shared_ptr would hit its atomic reference count on every access from every thread
+	auto componentPool = static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+	return componentPool->Get(entityId);
+}
+
+template<typename TComponent>
+const TComponent& Registry::ReadComponent(Entity entity) const {
+	const auto componentId = Component<TComponent>::GetId();
+	const auto entityId = entity.GetId();
+
+	if (System::currentSystem) {
+		System::currentSystem->CheckComponentAccess(componentId, false);
+	}
+
+	auto componentPool = static_cast<Pool<TComponent>*>(componentPools[componentId].get());
 	return componentPool->Get(entityId);
 }
 
 
+template<typename TComponent>
+const TComponent& Registry::GetPreviousComponent(Entity entity) const {
+	static_assert(IsDoubleBuffered<TComponent>::value, "Only double buffered components keep a previous state");
+	const auto componentId = Component<TComponent>::GetId();
+	const auto entityId = entity.GetId();
+
+	auto componentPool = static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+	return componentPool->GetPrevious(entityId);
+}
+
+template<typename TComponent, typename ...TArgs>
+void Registry::AddTransientComponent(Entity entity, TArgs && ...args) {
+	TComponent newComponent(std::forward<TArgs>(args)...);
+	GetTransientComponents<TComponent>().Add(entity, newComponent);
+}
+
+template<typename TComponent>
+TransientPool<TComponent>& Registry::GetTransientComponents() {
+	const auto componentId = Component<TComponent>::GetId();
+
+	if (componentId >= transientPools.size()) {
+		transientPools.resize(componentId + 1, nullptr);
+	}
+
+	if (!transientPools[componentId]) {
+		transientPools[componentId] = std::make_shared<TransientPool<TComponent>>();
+	}
+
+	return *std::static_pointer_cast<TransientPool<TComponent>>(transientPools[componentId]);
+}
+
+
 // System management functions: black box, dont fully understand how unordered maps work
 template<typename TSystem, typename ...TArgs>
 void Registry::AddSystem(TArgs && ...args) {
 	std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
+	newSystem->SetName(GetReadableTypeName(typeid(TSystem)));
 	systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
 }
 
@@ -252,6 +582,16 @@ void Entity::AddComponent(TArgs && ...args) {
 	registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
 }
 
+template<typename TComponent>
+const TComponent& Entity::GetPreviousComponent() const {
+	return registry->GetPreviousComponent<TComponent>(*this);
+}
+
+template<typename TComponent, typename ...TArgs>
+void Entity::AddTransientComponent(TArgs && ...args) {
+	registry->AddTransientComponent<TComponent>(*this, std::forward<TArgs>(args)...);
+}
+
 template<typename TComponent>
 void Entity::RemoveComponent() {
 	registry->RemoveComponent<TComponent>(*this);
@@ -266,3 +606,8 @@ template<typename TComponent>
 TComponent& Entity::GetComponent() const {
 	return registry->GetComponent<TComponent>(*this);
 }
+
+template<typename TComponent>
+const TComponent& Entity::ReadComponent() const {
+	return registry->ReadComponent<TComponent>(*this);
+}
@@ -0,0 +1,314 @@
+#include "FlightRecorder.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+FlightFrame* FlightRecorder::frames = nullptr;
+FlightZone* FlightRecorder::zones = nullptr;
+FlightLogLine* FlightRecorder::logLines = nullptr;
+std::atomic<uint64_t>* FlightRecorder::zoneSequences = nullptr;
+std::atomic<uint64_t>* FlightRecorder::logLineSequences = nullptr;
+FlightFrame* FlightRecorder::snapshotFrames = nullptr;
+FlightZone* FlightRecorder::snapshotZones = nullptr;
+FlightLogLine* FlightRecorder::snapshotLogLines = nullptr;
+uint64_t FlightRecorder::numSnapshotFrames = 0;
+uint64_t FlightRecorder::numSnapshotZones = 0;
+uint64_t FlightRecorder::numSnapshotLogLines = 0;
+std::atomic<uint64_t> FlightRecorder::frameCount{ 0 };
+std::atomic<uint64_t> FlightRecorder::zoneCount{ 0 };
+std::atomic<uint64_t> FlightRecorder::logLineCount{ 0 };
+std::atomic<uint32_t> FlightRecorder::nextThreadId{ 0 };
+thread_local uint32_t FlightRecorder::threadId = UINT32_MAX;
+double FlightRecorder::hitchMillisecs = 0.0;
+double FlightRecorder::cooldownSecs = 5.0;
+uint64_t FlightRecorder::lastDumpTime = 0;
+std::string FlightRecorder::dumpFilePrefix;
+
+// The dump thread writes the snapshot to pendingDumpPath, the path is cleared once the file is written
+static std::thread dumpThread;
+static std::mutex dumpMutex;
+static std::condition_variable dumpCondition;
+static std::string pendingDumpPath;
+static bool isDumpThreadRunning = false;
+
+void FlightRecorder::Initialize(double hitchMillisecs, const std::string& dumpFilePrefix, double cooldownSecs) {
+	Shutdown();
+	frames = new FlightFrame[MAX_FRAMES]();
+	zones = new FlightZone[MAX_ZONES]();
+	logLines = new FlightLogLine[MAX_LOG_LINES]();
+	zoneSequences = new std::atomic<uint64_t>[MAX_ZONES]();
+	logLineSequences = new std::atomic<uint64_t>[MAX_LOG_LINES]();
+	snapshotFrames = new FlightFrame[MAX_FRAMES]();
+	snapshotZones = new FlightZone[MAX_ZONES]();
+	snapshotLogLines = new FlightLogLine[MAX_LOG_LINES]();
+	frameCount = 0;
+	zoneCount = 0;
+	logLineCount = 0;
+	lastDumpTime = 0;
+	FlightRecorder::hitchMillisecs = hitchMillisecs;
+	FlightRecorder::dumpFilePrefix = dumpFilePrefix;
+	FlightRecorder::cooldownSecs = cooldownSecs;
+
+	if (hitchMillisecs > 0.0) {
+		isDumpThreadRunning = true;
+		dumpThread = std::thread(DumpLoop);
+	}
+}
+
+void FlightRecorder::Shutdown() {
+	// A dump in progress is finished first
+	if (dumpThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(dumpMutex);
+			isDumpThreadRunning = false;
+		}
+		dumpCondition.notify_all();
+		dumpThread.join();
+	}
+
+	delete[] frames;
+	delete[] zones;
+	delete[] logLines;
+	delete[] zoneSequences;
+	delete[] logLineSequences;
+	delete[] snapshotFrames;
+	delete[] snapshotZones;
+	delete[] snapshotLogLines;
+	frames = nullptr;
+	zones = nullptr;
+	logLines = nullptr;
+	zoneSequences = nullptr;
+	logLineSequences = nullptr;
+	snapshotFrames = nullptr;
+	snapshotZones = nullptr;
+	snapshotLogLines = nullptr;
+}
+
+void FlightRecorder::DumpLoop() {
+	std::unique_lock<std::mutex> lock(dumpMutex);
+	for (;;) {
+		dumpCondition.wait(lock, []() { return !pendingDumpPath.empty() || !isDumpThreadRunning; });
+		if (pendingDumpPath.empty()) {
+			return;
+		}
+
+		// The main thread leaves the snapshot alone until the path is cleared
+		const std::string filePath = pendingDumpPath;
+		lock.unlock();
+		WriteSnapshot(filePath);
+		lock.lock();
+		pendingDumpPath.clear();
+		dumpCondition.notify_all();
+	}
+}
+
+uint32_t FlightRecorder::GetThreadId() {
+	if (threadId == UINT32_MAX) {
+		threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+	}
+	return threadId;
+}
+
+bool FlightRecorder::BeginSlot(std::atomic<uint64_t>& sequence) {
+	// Another thread a whole lap around the ring still fills this slot, the record is dropped rather than mixed with it
+	uint64_t previous = sequence.load(std::memory_order_relaxed);
+	if (previous == WRITING || !sequence.compare_exchange_strong(previous, WRITING, std::memory_order_acquire, std::memory_order_relaxed)) {
+		return false;
+	}
+
+	// The slot is marked before any of its bytes change, a copy that raced with them sees the mark afterwards
+	std::atomic_thread_fence(std::memory_order_release);
+	return true;
+}
+
+void FlightRecorder::RecordZone(const char* name, uint64_t start, uint64_t end) {
+	if (!zones) {
+		return;
+	}
+	const uint64_t index = zoneCount.fetch_add(1, std::memory_order_relaxed);
+	std::atomic<uint64_t>& sequence = zoneSequences[index % MAX_ZONES];
+	if (!BeginSlot(sequence)) {
+		return;
+	}
+	zones[index % MAX_ZONES] = FlightZone{ name, start, end, GetThreadId() };
+	sequence.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::RecordLog(LogType type, const std::string& message) {
+	if (!logLines) {
+		return;
+	}
+	const uint64_t index = logLineCount.fetch_add(1, std::memory_order_relaxed);
+	std::atomic<uint64_t>& sequence = logLineSequences[index % MAX_LOG_LINES];
+	if (!BeginSlot(sequence)) {
+		return;
+	}
+	FlightLogLine& line = logLines[index % MAX_LOG_LINES];
+	line.time = Profiler::Now();
+	line.type = type;
+
+	// Long messages are cut, the slot has a fixed size
+	const size_t length = std::min<size_t>(message.size(), FlightLogLine::MAX_LENGTH - 1);
+	std::memcpy(line.text, message.data(), length);
+	line.text[length] = '\0';
+	sequence.store(index + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::EndFrame(uint64_t frameIndex, uint64_t start, uint64_t end, int numEntities) {
+	if (!frames) {
+		return false;
+	}
+	const uint64_t index = frameCount.fetch_add(1, std::memory_order_relaxed);
+	frames[index % MAX_FRAMES] = FlightFrame{ frameIndex, start, end, numEntities };
+
+	const double frameMillisecs = (end - start) / 1000000.0;
+	if (hitchMillisecs <= 0.0 || frameMillisecs < hitchMillisecs) {
+		return false;
+	}
+	if (lastDumpTime != 0 && (end - lastDumpTime) / 1000000000.0 < cooldownSecs) {
+		return false;
+	}
+
+	// The snapshot still belongs to the dump thread while it writes the previous file
+	std::unique_lock<std::mutex> lock(dumpMutex);
+	if (!pendingDumpPath.empty()) {
+		return false;
+	}
+	lastDumpTime = end;
+
+	TakeSnapshot();
+	pendingDumpPath = dumpFilePrefix + std::to_string(frameIndex) + ".json";
+	const std::string message = "Frame " + std::to_string(frameIndex) + " took " + std::to_string(frameMillisecs) + " ms, flight recorder dumping to " + pendingDumpPath;
+	lock.unlock();
+	dumpCondition.notify_all();
+
+	Logger::Err(message);
+	return true;
+}
+
+void FlightRecorder::TakeSnapshot() {
+	// Only the records still in the rings, the oldest ones have been overwritten
+	const uint64_t numFrames = frameCount.load(std::memory_order_acquire);
+	const uint64_t numZones = zoneCount.load(std::memory_order_acquire);
+	const uint64_t numLogLines = logLineCount.load(std::memory_order_acquire);
+	const uint64_t firstFrame = numFrames > MAX_FRAMES ? numFrames - MAX_FRAMES : 0;
+	const uint64_t firstZone = numZones > MAX_ZONES ? numZones - MAX_ZONES : 0;
+	const uint64_t firstLogLine = numLogLines > MAX_LOG_LINES ? numLogLines - MAX_LOG_LINES : 0;
+
+	// The frames are only written by the thread closing them, which is the one taking the snapshot
+	numSnapshotFrames = 0;
+	for (uint64_t i = firstFrame; i < numFrames; i++) {
+		snapshotFrames[numSnapshotFrames++] = frames[i % MAX_FRAMES];
+	}
+
+	// A slot that is being written or already holds a newer record is left out, the copy is checked again after the fact
+	numSnapshotZones = 0;
+	for (uint64_t i = firstZone; i < numZones; i++) {
+		const std::atomic<uint64_t>& sequence = zoneSequences[i % MAX_ZONES];
+		if (sequence.load(std::memory_order_acquire) != i + 1) {
+			continue;
+		}
+		snapshotZones[numSnapshotZones] = zones[i % MAX_ZONES];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) == i + 1) {
+			numSnapshotZones++;
+		}
+	}
+	numSnapshotLogLines = 0;
+	for (uint64_t i = firstLogLine; i < numLogLines; i++) {
+		const std::atomic<uint64_t>& sequence = logLineSequences[i % MAX_LOG_LINES];
+		if (sequence.load(std::memory_order_acquire) != i + 1) {
+			continue;
+		}
+		snapshotLogLines[numSnapshotLogLines] = logLines[i % MAX_LOG_LINES];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) == i + 1) {
+			numSnapshotLogLines++;
+		}
+	}
+}
+
+static void WriteJsonString(std::ofstream& file, const char* text) {
+	file << '"';
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			file << '\\' << *c;
+		} else if (static_cast<unsigned char>(*c) >= 0x20) {
+			file << *c;
+		}
+	}
+	file << '"';
+}
+
+bool FlightRecorder::Dump(const std::string& filePath) {
+	if (!frames) {
+		return false;
+	}
+	std::unique_lock<std::mutex> lock(dumpMutex);
+	dumpCondition.wait(lock, []() { return pendingDumpPath.empty(); });
+	TakeSnapshot();
+	return WriteSnapshot(filePath);
+}
+
+bool FlightRecorder::WriteSnapshot(const std::string& filePath) {
+	std::ofstream file(filePath);
+	if (!file) {
+		Logger::Err("Error opening flight recorder file: " + filePath);
+		return false;
+	}
+
+	uint64_t firstTimestamp = UINT64_MAX;
+	if (numSnapshotFrames > 0) {
+		firstTimestamp = snapshotFrames[0].start;
+	}
+	for (uint64_t i = 0; i < numSnapshotZones; i++) {
+		firstTimestamp = std::min(firstTimestamp, snapshotZones[i].start);
+	}
+	if (firstTimestamp == UINT64_MAX) {
+		firstTimestamp = 0;
+	}
+
+	// Frames get their own track (tid 0), the threads follow it
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+	for (uint64_t i = 0; i < numSnapshotFrames; i++) {
+		const FlightFrame& frame = snapshotFrames[i];
+		file << ",\n{\"name\":\"Frame " << frame.frameIndex << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0";
+		file << ",\"ts\":" << (frame.start - firstTimestamp) / 1000.0 << ",\"dur\":" << (frame.end - frame.start) / 1000.0;
+		file << ",\"args\":{\"entities\":" << frame.numEntities << "}}";
+	}
+	for (uint64_t i = 0; i < numSnapshotZones; i++) {
+		const FlightZone& zone = snapshotZones[i];
+		if (zone.start < firstTimestamp) {
+			continue;
+		}
+		file << ",\n{\"name\":";
+		WriteJsonString(file, zone.name);
+		file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.threadId + 1;
+		file << ",\"ts\":" << (zone.start - firstTimestamp) / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+	}
+	for (uint64_t i = 0; i < numSnapshotLogLines; i++) {
+		const FlightLogLine& line = snapshotLogLines[i];
+		if (line.time < firstTimestamp) {
+			continue;
+		}
+		file << ",\n{\"name\":";
+		WriteJsonString(file, line.text);
+		file << ",\"cat\":\"" << (line.type == LOG_ERROR ? "error" : "log") << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0";
+		file << ",\"ts\":" << (line.time - firstTimestamp) / 1000.0 << "}";
+	}
+	file << "\n]}\n";
+	return true;
+}
+
+FlightRecorderZone::FlightRecorderZone(const char* name): name(name), start(FlightRecorder::IsInitialized() ? Profiler::Now() : 0) {}
+
+FlightRecorderZone::~FlightRecorderZone() {
+	if (start != 0) {
+		FlightRecorder::RecordZone(name, start, Profiler::Now());
+	}
+}
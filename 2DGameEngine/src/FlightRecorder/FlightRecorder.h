@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "../Logger/Logger.h"
+
+// Always-on black box: keeps the last few seconds of frames, zones and log lines in fixed ring buffers
+// and writes them as a Chrome trace when a frame takes longer than the hitch threshold
+// Recording is a counter increment and a copy into a preallocated slot, nothing allocates after Initialize()
+// A hitch only copies the rings on the main thread, a background thread turns the copy into the JSON file
+
+struct FlightFrame {
+	uint64_t frameIndex;
+	uint64_t start;
+	uint64_t end;
+	int numEntities;
+};
+
+struct FlightZone {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	uint32_t threadId;
+};
+
+struct FlightLogLine {
+	static const int MAX_LENGTH = 128;
+
+	uint64_t time;
+	LogType type;
+	char text[MAX_LENGTH];
+};
+
+class FlightRecorder {
+private:
+	static const uint32_t MAX_FRAMES = 512;
+	static const uint32_t MAX_ZONES = 1 << 14;
+	static const uint32_t MAX_LOG_LINES = 512;
+
+	static FlightFrame* frames;
+	static FlightZone* zones;
+	static FlightLogLine* logLines;
+
+	// Any thread records zones and log lines, each slot holds the count + 1 of the record it has, or WRITING while
+	// a thread fills it, so a copy can leave out the slots that were being written instead of tearing them
+	static const uint64_t WRITING = UINT64_MAX;
+	static std::atomic<uint64_t>* zoneSequences;
+	static std::atomic<uint64_t>* logLineSequences;
+
+	// The records that were complete when the hitch was caught, oldest first, read by the dump thread
+	static FlightFrame* snapshotFrames;
+	static FlightZone* snapshotZones;
+	static FlightLogLine* snapshotLogLines;
+	static uint64_t numSnapshotFrames;
+	static uint64_t numSnapshotZones;
+	static uint64_t numSnapshotLogLines;
+
+	// Total number of records ever written, the slot is the counter modulo the capacity
+	static std::atomic<uint64_t> frameCount;
+	static std::atomic<uint64_t> zoneCount;
+	static std::atomic<uint64_t> logLineCount;
+	static std::atomic<uint32_t> nextThreadId;
+	static thread_local uint32_t threadId;
+
+	static double hitchMillisecs;
+	static double cooldownSecs;
+	static uint64_t lastDumpTime;
+	static std::string dumpFilePrefix;
+
+	static uint32_t GetThreadId();
+	static bool BeginSlot(std::atomic<uint64_t>& sequence);
+	static void TakeSnapshot();
+	static bool WriteSnapshot(const std::string& filePath);
+	static void DumpLoop();
+public:
+	// Allocates the ring buffers, a frame slower than hitchMillisecs dumps the trace (0 never dumps)
+	// Two dumps are at least cooldownSecs apart so a long stall doesn't write a file every frame
+	static void Initialize(double hitchMillisecs, const std::string& dumpFilePrefix, double cooldownSecs = 5.0);
+	static void Shutdown();
+	static bool IsInitialized() {
+		return frames != nullptr;
+	}
+
+	// Only the pointer is kept, the name has to stay valid until Shutdown()
+	static void RecordZone(const char* name, uint64_t start, uint64_t end);
+	static void RecordLog(LogType type, const std::string& message);
+
+	// Closes a frame and dumps the recording in the background when the frame was a hitch, returns true when a dump started
+	// A hitch caught while the previous file is still being written is skipped
+	static bool EndFrame(uint64_t frameIndex, uint64_t start, uint64_t end, int numEntities);
+
+	// Writes what the buffers hold right now on the calling thread, after any dump still in progress
+	static bool Dump(const std::string& filePath);
+};
+
+// Records the enclosing scope as a flight recorder zone, the name must live as long as the program
+class FlightRecorderZone {
+private:
+	const char* name;
+	uint64_t start;
+public:
+	FlightRecorderZone(const char* name);
+	~FlightRecorderZone();
+};
@@ -0,0 +1,120 @@
+#include "FramePacer.h"
+#include "../Logger/Logger.h"
+#include "../Profiler/Profiler.h"
+#include "../Metrics/Percentile.h"
+#include <algorithm>
+#include <cmath>
+
+FrameTimeHistogram::FrameTimeHistogram() {
+	buckets.resize(MAX_MILLISECS * BUCKETS_PER_MILLISEC + 1, 0);
+}
+
+void FrameTimeHistogram::Record(double millisecs) {
+	int bucket = static_cast<int>(millisecs * BUCKETS_PER_MILLISEC);
+	bucket = std::clamp(bucket, 0, static_cast<int>(buckets.size()) - 1);
+	buckets[bucket]++;
+
+	numFrames++;
+	totalMillisecs += millisecs;
+	maxMillisecs = std::max(maxMillisecs, millisecs);
+}
+
+void FrameTimeHistogram::Clear() {
+	std::fill(buckets.begin(), buckets.end(), 0);
+	numFrames = 0;
+	totalMillisecs = 0.0;
+	maxMillisecs = 0.0;
+}
+
+uint64_t FrameTimeHistogram::GetNumFrames() const {
+	return numFrames;
+}
+
+double FrameTimeHistogram::GetAverage() const {
+	return numFrames > 0 ? totalMillisecs / numFrames : 0.0;
+}
+
+double FrameTimeHistogram::GetMax() const {
+	return maxMillisecs;
+}
+
+double FrameTimeHistogram::GetPercentile(double percentile) const {
+	if (numFrames == 0) {
+		return 0.0;
+	}
+
+	const size_t bucket = GetPercentileBucket(buckets.data(), buckets.size(), numFrames, percentile);
+	if (bucket == buckets.size()) {
+		return maxMillisecs;
+	}
+	return std::min(static_cast<double>(bucket + 1) / BUCKETS_PER_MILLISEC, maxMillisecs);
+}
+
+FramePacer::FramePacer(int targetFrameRate) {
+	performanceFrequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	frameStart = SDL_GetPerformanceCounter();
+	SetTargetFrameRate(targetFrameRate);
+}
+
+void FramePacer::SetTargetFrameRate(int targetFrameRate) {
+	targetFrameMillisecs = targetFrameRate > 0 ? 1000.0 / targetFrameRate : 0.0;
+	Logger::Log("Target frame rate set to " + (targetFrameRate > 0 ? std::to_string(targetFrameRate) : std::string("uncapped")));
+}
+
+double FramePacer::GetTargetFrameMillisecs() const {
+	return targetFrameMillisecs;
+}
+
+double FramePacer::MillisecsSince(Uint64 counter) const {
+	return (SDL_GetPerformanceCounter() - counter) * 1000.0 / performanceFrequency;
+}
+
+void FramePacer::WaitForNextFrame() {
+	PROFILE_ZONE("FramePacer::WaitForNextFrame");
+	double elapsed = MillisecsSince(frameStart);
+
+	if (targetFrameMillisecs > 0.0) {
+		if (elapsed > targetFrameMillisecs) {
+			missedFrames++;
+		}
+
+		// Let the OS have the CPU for most of the remaining time...
+		double remaining = targetFrameMillisecs - elapsed;
+		if (remaining > SPIN_MILLISECS) {
+			SDL_Delay(static_cast<Uint32>(remaining - SPIN_MILLISECS));
+		}
+
+		// ...and spin the last part to hit the deadline precisely
+		while (elapsed < targetFrameMillisecs) {
+			elapsed = MillisecsSince(frameStart);
+		}
+	}
+
+	histogram.Record(elapsed);
+	frameStart = SDL_GetPerformanceCounter();
+}
+
+const FrameTimeHistogram& FramePacer::GetHistogram() const {
+	return histogram;
+}
+
+uint64_t FramePacer::GetMissedFrames() const {
+	return missedFrames;
+}
+
+void FramePacer::ResetStats() {
+	histogram.Clear();
+	missedFrames = 0;
+}
+
+void FramePacer::LogReport() const {
+	Logger::Log(
+		"Frames: " + std::to_string(histogram.GetNumFrames()) +
+		" avg: " + std::to_string(histogram.GetAverage()) + "ms" +
+		" p50: " + std::to_string(histogram.GetPercentile(50)) + "ms" +
+		" p95: " + std::to_string(histogram.GetPercentile(95)) + "ms" +
+		" p99: " + std::to_string(histogram.GetPercentile(99)) + "ms" +
+		" max: " + std::to_string(histogram.GetMax()) + "ms" +
+		" missed: " + std::to_string(missedFrames)
+	);
+}
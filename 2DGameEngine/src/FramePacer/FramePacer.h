@@ -0,0 +1,61 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <vector>
+
+// Frame times bucketed by 0.1 ms up to 250 ms, anything slower goes to the last bucket
+// Fixed memory, recording a frame is just an increment
+class FrameTimeHistogram {
+private:
+	static const int BUCKETS_PER_MILLISEC = 10;
+	static const int MAX_MILLISECS = 250;
+
+	std::vector<uint32_t> buckets;
+	uint64_t numFrames = 0;
+	double totalMillisecs = 0.0;
+	double maxMillisecs = 0.0;
+public:
+	FrameTimeHistogram();
+
+	void Record(double millisecs);
+	void Clear();
+
+	uint64_t GetNumFrames() const;
+	double GetAverage() const;
+	double GetMax() const;
+
+	// percentile goes from 0 to 100, the result is the upper bound of the bucket in milliseconds
+	double GetPercentile(double percentile) const;
+};
+
+// Caps the frame rate by sleeping most of the remaining frame time and spinning the last bit for sub millisecond accuracy
+class FramePacer {
+private:
+	// Sleeping is only accurate to about a millisecond (more on some systems), so we stop sleeping this long before the deadline
+	static constexpr double SPIN_MILLISECS = 2.0;
+
+	double performanceFrequency;
+	Uint64 frameStart;
+	double targetFrameMillisecs = 0.0;
+	uint64_t missedFrames = 0;
+
+	FrameTimeHistogram histogram;
+
+	double MillisecsSince(Uint64 counter) const;
+public:
+	// targetFrameRate = 0 means uncapped
+	FramePacer(int targetFrameRate = 0);
+
+	void SetTargetFrameRate(int targetFrameRate);
+	double GetTargetFrameMillisecs() const;
+
+	// Called at the end of every frame, waits until the next frame is due and records how long this one took
+	void WaitForNextFrame();
+
+	const FrameTimeHistogram& GetHistogram() const;
+	uint64_t GetMissedFrames() const;
+	void ResetStats();
+
+	// Logs p50/p95/p99 and the missed frames
+	void LogReport() const;
+};
@@ -12,15 +12,15 @@
 
 #include "../Systems/MovementSystem.h"
 #include "../Systems/RenderSystem.h"
+#include "../World/World.h"
 
 
-glm::vec2 playerPosition;
-glm::vec2 playerVelocity;
-
 Game::Game() {
 	isRunning = false;
 	registry = std::make_unique<Registry>();
 	assetBank = std::make_unique<AssetBank>();
+	jobSystem = std::make_unique<JobSystem>();
+	systemScheduler = std::make_unique<SystemScheduler>();
 
 	Logger::Log("Game Constructor Called");
 }
@@ -28,6 +28,24 @@ Game::~Game() {
 	Logger::Err("Game Destructor Called");
 }
 void Game::Initialize() {
+	if (!binaryLogFilePath.empty()) {
+		BinaryLog::Open(binaryLogFilePath);
+	}
+
+	if (isHeadless) {
+		// Only the timer and the event queue, no video or audio device is needed
+		if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0) {
+			Logger::Err("Error initializing SDL");
+			return;
+		}
+
+		framePacer = std::make_unique<FramePacer>(targetFrameRate);
+
+		Logger::Log("Running headless");
+		isRunning = true;
+		return;
+	}
+
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
 		Logger::Err("Error initializing SDL");
 		return;
@@ -60,6 +78,14 @@ void Game::Initialize() {
 
 	SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
 
+	performanceOverlay = std::make_unique<PerformanceOverlay>(renderer, windowWidth, windowHeight);
+	if (memoryReportInterval > 0.0) {
+		performanceOverlay->SetMemoryRefreshInterval(memoryReportInterval * 1000.0);
+	}
+
+	// The pacer needs the SDL timer, so it's created once SDL is initialized
+	framePacer = std::make_unique<FramePacer>(targetFrameRate);
+
 	isRunning = true;
 }
 void Game::Setup() {
@@ -68,38 +94,286 @@ void Game::Setup() {
 	registry->AddSystem<MovementSystem>();
 	registry->AddSystem<RenderSystem>();
 
-	// Adding assets to the assets bank
-	assetBank->AddTexture(renderer, "tank-image", "../assets/images/tank-panther-right.png");
-	assetBank->AddTexture(renderer, "truck-image", "../assets/images/truck-ford-right.png");
-
-	Entity tank = registry->CreateEntity();
-	Entity truck = registry->CreateEntity();
-
-	tank.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(1.0, 1.0), 0.0);
-	tank.AddComponent<RigidBodyComponent>(glm::vec2(40.0, 10.0));
-	tank.AddComponent<SpriteComponent>("tank-image", 10, 10);
+	// Adding assets to the assets bank, textures need a renderer so there's nothing to load headless
+	if (!isHeadless) {
+		assetBank->AddTexture(renderer, "tank-image", "../assets/images/tank-panther-right.png");
+		assetBank->AddTexture(renderer, "truck-image", "../assets/images/truck-ford-right.png");
+	}
 
-	truck.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(1.0, 1.0), 0.0);
-	truck.AddComponent<RigidBodyComponent>(glm::vec2(40.0, 10.0));
-	truck.AddComponent<SpriteComponent>("truck-image", 10, 50);
+	World::SpawnDefaultUnits(*registry);
 
+	if (stressTest) {
+		stressTest->Spawn(*registry, windowWidth, windowHeight);
+	}
 }
 void Game::Destroy() {
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
+	if (framePacer) {
+		framePacer->LogReport();
+	}
+
+	// The overlay uses the renderer, it has to go first
+	performanceOverlay.reset();
+
+	if (renderer) {
+		SDL_DestroyRenderer(renderer);
+	}
+	if (window) {
+		SDL_DestroyWindow(window);
+	}
 	SDL_Quit();
+
+	// The workers are idle once the game stopped, nothing else can be logging to the file
+	BinaryLog::Close();
 }
 void Game::Run() {
 	Setup();
+
+	if (!replayFilePath.empty()) {
+		inputPlayer = std::make_unique<InputPlayer>();
+		if (!inputPlayer->Open(replayFilePath)) {
+			hasReplayFailed = true;
+			return;
+		}
+		// The replay has to step exactly like the recording did
+		fixedDeltaTime = inputPlayer->GetFixedDeltaTime();
+	}
+	if (!recordFilePath.empty()) {
+		inputRecorder = std::make_unique<InputRecorder>();
+		inputRecorder->Open(recordFilePath, fixedDeltaTime);
+	}
+
+	PROFILE_THREAD("Main");
+	if (!profileFilePath.empty()) {
+		Profiler::BeginCapture();
+	}
+	FlightRecorder::Initialize(hitchMillisecs, hitchFilePrefix);
+	if (!metricsTarget.empty()) {
+		Metrics::StartExport(metricsTarget, metricsIntervalSecs);
+	}
+	MetricHistogram& frameTimeMetric = Metrics::GetHistogram("game.frame_ms");
+	MetricGauge& entitiesMetric = Metrics::GetGauge("ecs.entities");
+	MetricHistogram& queueDepthMetric = Metrics::GetHistogram("jobs.queue_depth");
+
+	const double performanceFrequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	performanceCounterPreviousFrame = SDL_GetPerformanceCounter();
+	AllocationTracker::SetFrameThread(true);
+
 	while (isRunning) {
+		const uint64_t frameStart = Profiler::Now();
+
+		if (AllocationTracker::IsEnabled()) {
+			AllocationTracker::SetExpectZeroAllocations(zeroAllocationsAfterFrame > 0 && frameCount >= zeroAllocationsAfterFrame);
+			AllocationTracker::BeginFrame();
+		}
+
+		// Jobs that need the main thread (SDL calls) are executed here
+		jobSystem->RunMainThreadJobs();
+
+		Uint64 performanceCounterCurrentFrame = SDL_GetPerformanceCounter();
+		double frameTime = (performanceCounterCurrentFrame - performanceCounterPreviousFrame) / performanceFrequency;
+		performanceCounterPreviousFrame = performanceCounterCurrentFrame;
+
+		// The first interval only measures the setup
+		if (stressTest && frameCount > 0) {
+			stressTest->RecordFrame(frameTime * 1000.0);
+		}
+		if (performanceOverlay) {
+			performanceOverlay->RecordFrame(frameTime * 1000.0);
+		}
+		if (frameCount > 0) {
+			frameTimeMetric.Record(frameTime * 1000.0);
+		}
+		entitiesMetric.Set(registry->GetNumEntities());
+
+		// Sampled once per frame, recording it on every Enqueue() made the workers fight over the histogram
+		queueDepthMetric.Record(jobSystem->TakePeakQueuedJobs());
+		if (memoryReportInterval > 0.0) {
+			memoryReportElapsed += frameTime;
+			if (memoryReportElapsed >= memoryReportInterval) {
+				registry->LogMemoryStats();
+				memoryReportElapsed = 0.0;
+			}
+		}
+
+		// Headless there is nothing to catch up with, every frame simulates exactly one step and the pacer sets the tick rate
+		double simulatedTime = (isHeadless && !inputPlayer) ? fixedDeltaTime : frameTime;
+
+		// The recording holds the time that was simulated, so a replay runs the same steps every frame whether it is headless or not
+		if (inputPlayer && !inputPlayer->NextFrame(simulatedTime)) {
+			isRunning = false;
+			break;
+		}
+		if (inputRecorder) {
+			inputRecorder->BeginFrame(simulatedTime);
+		}
+
 		ProcessInput();
-		Update();
-		Render();
+
+		// Run the simulation in fixed steps for however much time has passed
+		accumulatedTime += simulatedTime;
+		int simulationSteps = 0;
+		while (accumulatedTime >= fixedDeltaTime && simulationSteps < MAX_SIMULATION_STEPS_PER_FRAME) {
+			FlightRecorderZone zone("Update");
+			Update(fixedDeltaTime);
+			accumulatedTime -= fixedDeltaTime;
+			simulationSteps++;
+		}
+
+		// We can't keep up, drop the time we couldn't simulate instead of falling further behind every frame
+		if (accumulatedTime >= fixedDeltaTime) {
+			accumulatedTime = 0.0;
+		}
+
+		// The leftover time tells how far we are between the last two simulation steps
+		{
+			FlightRecorderZone zone("Render");
+			Render(accumulatedTime / fixedDeltaTime);
+		}
+
+		if (inputRecorder) {
+			inputRecorder->EndFrame(ComputeStateHash());
+		}
+		if (inputPlayer) {
+			inputPlayer->CheckStateHash(ComputeStateHash());
+		}
+
+		// Don't spin the CPU faster than the target frame rate
+		{
+			FlightRecorderZone zone("WaitForNextFrame");
+			framePacer->WaitForNextFrame();
+		}
+		FlightRecorder::EndFrame(frameCount, frameStart, Profiler::Now(), registry->GetNumEntities());
+
+		if (AllocationTracker::IsEnabled()) {
+			AllocationTracker::EndFrame();
+		}
+
+		frameCount++;
+		if (maxFrames > 0 && frameCount >= maxFrames) {
+			isRunning = false;
+		}
+	}
+
+	if (stressTest) {
+		stressTest->Report(*registry, stressOutFilePath);
+	}
+	if (AllocationTracker::IsEnabled()) {
+		AllocationTracker::LogReport();
 	}
+
+	// The zones point to the system names, so the trace is written while the systems still exist
+	if (!profileFilePath.empty()) {
+		Profiler::EndCapture();
+		Profiler::ExportChromeTrace(profileFilePath);
+	}
+
+	// Flush the files before the game gets destroyed
+	if (inputPlayer && inputPlayer->HasDiverged()) {
+		hasReplayFailed = true;
+	}
+	inputRecorder.reset();
+	inputPlayer.reset();
+	FlightRecorder::Shutdown();
+	Metrics::StopExport();
+}
+uint64_t Game::ComputeStateHash() const {
+	uint64_t hash = HASH_SEED;
+	for (auto entity: registry->GetSystem<MovementSystem>().GetSystemEntities()) {
+		const auto& transform = entity.GetComponent<TransformComponent>();
+		const auto& rigidBody = entity.GetComponent<RigidBodyComponent>();
+		const int entityId = entity.GetId();
+
+		hash = HashBytes(hash, &entityId, sizeof(entityId));
+		hash = HashBytes(hash, &transform.position, sizeof(transform.position));
+		hash = HashBytes(hash, &transform.rotation, sizeof(transform.rotation));
+		hash = HashBytes(hash, &rigidBody.velocity, sizeof(rigidBody.velocity));
+	}
+	return hash;
+}
+void Game::SetMemoryReportInterval(double seconds) {
+	memoryReportInterval = seconds;
+}
+void Game::SetZeroAllocationsAfter(uint64_t warmupFrames) {
+	zeroAllocationsAfterFrame = warmupFrames;
+}
+void Game::SetHitchDump(double millisecs, const std::string& filePrefix) {
+	hitchMillisecs = millisecs;
+	hitchFilePrefix = filePrefix;
+}
+void Game::SetMetricsExport(const std::string& target, double intervalSecs) {
+	metricsTarget = target;
+	metricsIntervalSecs = intervalSecs;
+}
+void Game::SetBinaryLogFile(const std::string& filePath) {
+	binaryLogFilePath = filePath;
+}
+void Game::SetSimulationRate(int ticksPerSecond) {
+	if (ticksPerSecond <= 0) {
+		Logger::Err("Invalid simulation rate: " + std::to_string(ticksPerSecond));
+		return;
+	}
+	fixedDeltaTime = 1.0 / ticksPerSecond;
+}
+void Game::SetTargetFrameRate(int framesPerSecond) {
+	targetFrameRate = framesPerSecond;
+	if (framePacer) {
+		framePacer->SetTargetFrameRate(framesPerSecond);
+	}
+}
+void Game::SetHeadless(bool headless) {
+	isHeadless = headless;
+}
+bool Game::IsHeadless() const {
+	return isHeadless;
+}
+bool Game::HasReplayFailed() const {
+	return hasReplayFailed;
+}
+void Game::SetMaxFrames(uint64_t frames) {
+	maxFrames = frames;
+}
+void Game::SetRecordFile(const std::string& filePath) {
+	recordFilePath = filePath;
+}
+void Game::SetReplayFile(const std::string& filePath) {
+	replayFilePath = filePath;
+}
+void Game::SetProfileFile(const std::string& filePath) {
+	profileFilePath = filePath;
+}
+void Game::SetStressTest(int numEntities, const std::string& outFilePath) {
+	stressTest = numEntities > 0 ? std::make_unique<StressTest>(numEntities) : nullptr;
+	stressOutFilePath = outFilePath;
+}
+bool Game::PollEvent(SDL_Event& sdlEvent) {
+	if (inputPlayer) {
+		if (inputPlayer->PollEvent(sdlEvent)) {
+			return true;
+		}
+
+		// The real input is ignored during a replay, except for closing the window
+		SDL_Event realEvent;
+		while (SDL_PollEvent(&realEvent)) {
+			if (realEvent.type == SDL_QUIT) {
+				sdlEvent = realEvent;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	if (!SDL_PollEvent(&sdlEvent)) {
+		return false;
+	}
+	if (inputRecorder) {
+		inputRecorder->RecordEvent(sdlEvent);
+	}
+	return true;
 }
 void Game::ProcessInput() {
+	PROFILE_ZONE("Game::ProcessInput");
 	SDL_Event sdlEvent;
-	while (SDL_PollEvent(&sdlEvent)) {
+	while (PollEvent(sdlEvent)) {
 		switch (sdlEvent.type) {
 			case SDL_QUIT:
 				isRunning = false;
@@ -108,29 +382,54 @@ void Game::ProcessInput() {
 				if (sdlEvent.key.keysym.sym == SDLK_ESCAPE) {
 					isRunning = false;
 				}
+				if (sdlEvent.key.keysym.sym == SDLK_F1 && performanceOverlay) {
+					performanceOverlay->Toggle();
+				}
 				break;
 		}
 	}
 }
-void Game::Update() {
+void Game::Update(double deltaTime) {
+	PROFILE_ZONE("Game::Update");
+
+	static MetricCounter& ticksMetric = Metrics::GetCounter("game.ticks");
+	ticksMetric.Add();
 
-	double deltaTime = (SDL_GetTicks() - millisecsPreviousFrame) / 1000.0;
-	millisecsPreviousFrame = SDL_GetTicks();
+	// Frame boundary: the double buffered components keep the last frame state before the systems change them
+	registry->SwapBuffers();
 
-	// Invoke all the sustems that need to update 
-	registry->GetSystem<MovementSystem>().Update(deltaTime);
+	// Schedule all the systems that need to update, the scheduler runs the ones that don't conflict in parallel
+	systemScheduler->Schedule(registry->GetSystem<MovementSystem>(), [this, deltaTime]() {
+		registry->GetSystem<MovementSystem>().Update(deltaTime, *jobSystem);
+	});
+	systemScheduler->Run(*jobSystem);
 
 	// Update at the end the registry to process the entities that are waiting to be created/deleted
 	registry->Update();
 }
-void Game::Render() {
+void Game::Render(double interpolation) {
+	if (!renderer) {
+		return;
+	}
+	PROFILE_ZONE("Game::Render");
+
 	SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
 	SDL_RenderClear(renderer);
 
-	// Invoke all the systems that need to render
-	registry->GetSystem<RenderSystem>().Update(renderer);
+	// Invoke all the systems that need to render, SDL calls have to stay on the main thread
+	systemScheduler->Schedule(registry->GetSystem<RenderSystem>(), [this, interpolation]() {
+		registry->GetSystem<RenderSystem>().Update(renderer, *assetBank, interpolation);
+	}, true);
+	systemScheduler->Run(*jobSystem);
 
-	SDL_RenderPresent(renderer);
+	if (performanceOverlay) {
+		performanceOverlay->Render(*registry, *assetBank, *framePacer);
+	}
+
+	{
+		PROFILE_ZONE("SDL_RenderPresent");
+		SDL_RenderPresent(renderer);
+	}
 }
 
 
@@ -4,22 +4,81 @@
 #include<SDL.h>
 #include "../ECS/ECS.h"
 #include "../AssetBank/AssetBank.h"
+#include "../JobSystem/JobSystem.h"
+#include "../Scheduler/SystemScheduler.h"
+#include "../FramePacer/FramePacer.h"
+#include "../Replay/InputReplay.h"
+#include "../Stress/StressTest.h"
+#include "../Profiler/Profiler.h"
+#include "../Overlay/PerformanceOverlay.h"
+#include "../AllocationTracker/AllocationTracker.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include "../Metrics/Metrics.h"
 
-// how many frames are refreshed in one second
+// how many frames are refreshed in one second, the frame pacer works out the frame time from it
 const int FPS = 60;
 
-// how many secods takes a frame to last (or expected)
-const int MILLISECS_PER_FRAME = 1000 / FPS;
+// how many simulation steps run in one second, independent from how often we render
+const int SIMULATION_TICKS_PER_SECOND = 60;
+
+// spiral of death guard: a slow frame never runs more steps than this, the remaining time is dropped
+const int MAX_SIMULATION_STEPS_PER_FRAME = 5;
 
 class Game {
 private:
-	SDL_Window* window;
-	SDL_Renderer* renderer;
+	SDL_Window* window = nullptr;
+	SDL_Renderer* renderer = nullptr;
 	bool isRunning;
-	int millisecsPreviousFrame = 0;
+
+	// Headless mode runs the simulation without window, renderer or audio (servers, CI, soak tests)
+	bool isHeadless = false;
+
+	// Stops the game after this number of frames, 0 runs until the game is closed
+	uint64_t maxFrames = 0;
+	uint64_t frameCount = 0;
+
+	std::string recordFilePath;
+	std::string replayFilePath;
+
+	// Fixed timestep state, time is measured with the high resolution performance counter
+	Uint64 performanceCounterPreviousFrame = 0;
+	double accumulatedTime = 0.0;
+	double fixedDeltaTime = 1.0 / SIMULATION_TICKS_PER_SECOND;
+	int targetFrameRate = FPS;
 
 	std::unique_ptr<Registry> registry;
 	std::unique_ptr<AssetBank> assetBank;
+	std::unique_ptr<JobSystem> jobSystem;
+	std::unique_ptr<SystemScheduler> systemScheduler;
+	std::unique_ptr<FramePacer> framePacer;
+	std::unique_ptr<InputRecorder> inputRecorder;
+	std::unique_ptr<InputPlayer> inputPlayer;
+	bool hasReplayFailed = false;
+	std::unique_ptr<StressTest> stressTest;
+	std::unique_ptr<PerformanceOverlay> performanceOverlay;
+	std::string stressOutFilePath;
+	std::string profileFilePath;
+
+	// Logs the registry memory every memoryReportInterval seconds, 0 disables it
+	double memoryReportInterval = 0.0;
+	double memoryReportElapsed = 0.0;
+
+	// Frames after this one must not allocate (needs ENABLE_ALLOCATION_TRACKER), 0 disables the check
+	uint64_t zeroAllocationsAfterFrame = 0;
+
+	// The flight recorder always runs, a frame slower than this dumps its trace (0 never dumps)
+	double hitchMillisecs = 100.0;
+	std::string hitchFilePrefix = "hitch-";
+
+	// Where the metrics go (a file or udp://host:port), empty keeps them in memory
+	std::string metricsTarget;
+	double metricsIntervalSecs = 10.0;
+
+	// Binary log file for the high volume logs (entity spawns), empty keeps them as text
+	std::string binaryLogFilePath;
+
+	// Input comes from SDL or from the replay, and gets recorded if needed
+	bool PollEvent(SDL_Event& sdlEvent);
 
 public:
 	Game();
@@ -30,11 +89,52 @@ public:
 	void Run();
 
 	void ProcessInput();
-	void Update();
-	void Render();
+	void Update(double deltaTime);
+	void Render(double interpolation);
 	void Setup();
 
-	int windowWidth;
-	int windowHeight;
+	// Changes how many simulation steps run per second, rendering keeps going at the display rate
+	void SetSimulationRate(int ticksPerSecond);
+
+	// Caps how many frames are rendered per second, 0 means uncapped
+	void SetTargetFrameRate(int framesPerSecond);
+
+	// Has to be called before Initialize()
+	void SetHeadless(bool headless);
+	bool IsHeadless() const;
+	void SetMaxFrames(uint64_t frames);
+
+	// Record the session to a file, or play a recorded one back (has to be called before Initialize())
+	void SetRecordFile(const std::string& filePath);
+	void SetReplayFile(const std::string& filePath);
+
+	// True when the replay couldn't be opened or didn't end a frame in the recorded state, valid after Run()
+	bool HasReplayFailed() const;
+
+	// Spawns numEntities random tanks and trucks and reports the frame, system and memory costs at the end of the run
+	void SetStressTest(int numEntities, const std::string& outFilePath);
+
+	// Captures the profiler zones of the whole run and writes them as a Chrome trace (needs ENABLE_PROFILER)
+	void SetProfileFile(const std::string& filePath);
+
+	void SetMemoryReportInterval(double seconds);
+
+	// Asserts that every frame after warmupFrames performs no heap allocation
+	void SetZeroAllocationsAfter(uint64_t warmupFrames);
+
+	// Frames slower than millisecs write the last seconds of the flight recorder to <filePrefix><frame>.json
+	void SetHitchDump(double millisecs, const std::string& filePrefix);
+
+	// Exports the metrics in the statsd format every intervalSecs while the game runs
+	void SetMetricsExport(const std::string& target, double intervalSecs);
+
+	// Has to be called before Initialize(), decode the file with tools/LogDecoder
+	void SetBinaryLogFile(const std::string& filePath);
+
+	// Hash of the simulation state, a replay must produce the same value every frame
+	uint64_t ComputeStateHash() const;
+
+	int windowWidth = 800;
+	int windowHeight = 600;
 }; 
 #endif
@@ -1,12 +1,148 @@
 #include <iostream>
+#include <string>
 #include "Game.h"
+#include "../CommandLine/ParseNumber.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include "../World/World.h"
+
+// Dedicated server: many independent worlds ticked on the shared job pool, no window
+// Headless only needs the timer, otherwise the events are initialized too so Ctrl+C stops the server cleanly
+int RunServer(bool isHeadless, int numWorlds, int tickRate, uint64_t maxFrames, double hitchMillisecs, const std::string& hitchFilePrefix,
+    const std::string& metricsTarget, double metricsInterval) {
+    const Uint32 subsystems = isHeadless ? SDL_INIT_TIMER : SDL_INIT_TIMER | SDL_INIT_EVENTS;
+    if (SDL_Init(subsystems) != 0) {
+        Logger::Err("Error initializing SDL for the server: " + std::string(SDL_GetError()));
+        return 1;
+    }
+    FlightRecorder::Initialize(hitchMillisecs, hitchFilePrefix);
+    if (!metricsTarget.empty()) {
+        Metrics::StartExport(metricsTarget, metricsInterval);
+    }
+    {
+        JobSystem jobSystem;
+        WorldHost worldHost(jobSystem);
+
+        for (int i = 0; i < numWorlds; i++) {
+            worldHost.CreateWorld("world-" + std::to_string(i)).Setup();
+        }
+        worldHost.Run(tickRate, maxFrames);
+
+        // The zones point to the system names, a dump still in progress has to finish while the worlds exist
+        FlightRecorder::Shutdown();
+    }
+    Metrics::StopExport();
+    SDL_Quit();
+
+    return 0;
+}
+
+static const char* USAGE =
+    "Usage: 2DGameEngine [--headless] [--tick-rate <ticks per second, 0 = uncapped>] [--frames <count>] [--worlds <count>]\n"
+    "                    [--record <file>] [--replay <file>] [--stress <entities> [--stress-out <file.json>]]\n"
+    "                    [--profile <trace.json>] [--memory-report <seconds>]\n"
+    "                    [--zero-alloc-after <frames>] [--hitch-ms <millisecs, 0 = never dump>] [--hitch-dump <file prefix>]\n"
+    "                    [--metrics <file or udp://host:port> [--metrics-interval <seconds>]] [--binary-log <file.blog>]\n";
 
 int main(int argc, char* argv[]) {
+    bool isHeadless = false;
+    int tickRate = -1;
+    uint64_t maxFrames = 0;
+    int numWorlds = 0;
+    std::string recordFilePath;
+    std::string replayFilePath;
+    int stressEntities = 0;
+    std::string stressOutFilePath;
+    std::string profileFilePath;
+    double memoryReportInterval = 0.0;
+    uint64_t zeroAllocationsAfter = 0;
+    double hitchMillisecs = 100.0;
+    std::string hitchFilePrefix = "hitch-";
+    std::string metricsTarget;
+    double metricsInterval = 10.0;
+    std::string binaryLogFilePath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            isHeadless = true;
+        } else if (arg == "--tick-rate" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], tickRate, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--frames" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], maxFrames, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--worlds" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], numWorlds, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordFilePath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFilePath = argv[++i];
+        } else if (arg == "--stress" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], stressEntities, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--stress-out" && i + 1 < argc) {
+            stressOutFilePath = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profileFilePath = argv[++i];
+        } else if (arg == "--memory-report" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], memoryReportInterval, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--zero-alloc-after" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], zeroAllocationsAfter, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--hitch-ms" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], hitchMillisecs, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--hitch-dump" && i + 1 < argc) {
+            hitchFilePrefix = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metricsTarget = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            if (!ParseNumber(arg, argv[++i], metricsInterval, USAGE)) {
+                return 2;
+            }
+        } else if (arg == "--binary-log" && i + 1 < argc) {
+            binaryLogFilePath = argv[++i];
+        } else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    if (numWorlds > 0) {
+        return RunServer(isHeadless, numWorlds, tickRate >= 0 ? tickRate : SIMULATION_TICKS_PER_SECOND, maxFrames, hitchMillisecs, hitchFilePrefix, metricsTarget, metricsInterval);
+    }
+
     Game game;
+    game.SetHeadless(isHeadless);
+    game.SetMaxFrames(maxFrames);
+    game.SetRecordFile(recordFilePath);
+    game.SetReplayFile(replayFilePath);
+    game.SetStressTest(stressEntities, stressOutFilePath);
+    game.SetProfileFile(profileFilePath);
+    game.SetMemoryReportInterval(memoryReportInterval);
+    game.SetZeroAllocationsAfter(zeroAllocationsAfter);
+    game.SetHitchDump(hitchMillisecs, hitchFilePrefix);
+    game.SetMetricsExport(metricsTarget, metricsInterval);
+    game.SetBinaryLogFile(binaryLogFilePath);
+    if (tickRate >= 0) {
+        game.SetTargetFrameRate(tickRate);
+        if (tickRate > 0) {
+            game.SetSimulationRate(tickRate);
+        }
+    }
 
     game.Initialize();
     game.Run();
     game.Destroy();
 
-    return 0;
-}
\ No newline at end of file
+    // Scripts run the replays as regression tests, a divergence has to fail them
+    return game.HasReplayFailed() ? 3 : 0;
+}
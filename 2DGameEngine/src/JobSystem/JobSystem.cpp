@@ -0,0 +1,306 @@
+#include "JobSystem.h"
+#include "../AllocationTracker/AllocationTracker.h"
+#include "../Logger/Logger.h"
+
+// The job system a worker thread belongs to and the thread's deque in it, -1 when the thread isn't a worker
+// Only that job system may use the index, a worker of one pool scheduling on another pool goes through the injected jobs
+// The main thread is recognized by its id instead, it can create several pools and each of them owns it
+static thread_local const JobSystem* currentJobSystem = nullptr;
+static thread_local int currentWorkerIndex = -1;
+static thread_local uint32_t stealSeed = 0;
+
+JobDeque::JobDeque() {
+	for (auto& slot: buffer) {
+		slot.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+bool JobDeque::Push(Job* job) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+
+	// The deque is full, the caller will run the job itself
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+
+	buffer[b & MASK].store(job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job* JobDeque::Pop() {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		// Empty deque, restore the bottom
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = buffer[b & MASK].load(std::memory_order_relaxed);
+	if (t == b) {
+		// Last job left, race against the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobDeque::Steal() {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return nullptr;
+	}
+
+	Job* job = buffer[t & MASK].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		// Another thread got it first
+		return nullptr;
+	}
+	return job;
+}
+
+int JobDeque::GetSize() const {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_relaxed);
+	return b > t ? static_cast<int>(b - t) : 0;
+}
+
+JobSystem::JobSystem(int numWorkers) {
+	if (numWorkers <= 0) {
+		numWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+		if (numWorkers < 1) {
+			numWorkers = 1;
+		}
+	}
+
+	// The thread that creates the job system is the main thread
+	mainThreadId = std::this_thread::get_id();
+
+	for (int i = 0; i <= numWorkers; i++) {
+		deques.push_back(std::make_unique<JobDeque>());
+	}
+
+	isRunning = true;
+	for (int i = 1; i <= numWorkers; i++) {
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+
+	Logger::Log("JobSystem constructor called with " + std::to_string(numWorkers) + " workers.");
+}
+
+JobSystem::~JobSystem() {
+	isRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	wakeCondition.notify_all();
+
+	for (auto& worker: workers) {
+		worker.join();
+	}
+
+	// Whatever was left in the queues never ran, just release it
+	for (auto& deque: deques) {
+		while (Job* job = deque->Pop()) {
+			delete job;
+		}
+	}
+	for (auto job: injectedJobs) {
+		delete job;
+	}
+	for (auto job: mainThreadJobs) {
+		delete job;
+	}
+
+	Logger::Err("JobSystem destructor called");
+}
+
+int JobSystem::GetNumWorkers() const {
+	return static_cast<int>(workers.size());
+}
+
+int JobSystem::GetQueuedJobs() const {
+	return queuedJobs.load(std::memory_order_relaxed);
+}
+
+int JobSystem::TakePeakQueuedJobs() {
+	return peakQueuedJobs.exchange(0, std::memory_order_relaxed);
+}
+
+bool JobSystem::IsMainThread() const {
+	return GetCurrentThreadIndex() == 0;
+}
+
+void JobSystem::Schedule(std::function<void()> task, JobCounter* counter) {
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	Enqueue(new Job{ std::move(task), counter, Logger::threadHistory });
+}
+
+void JobSystem::ScheduleOnMainThread(std::function<void()> task, JobCounter* counter) {
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	std::lock_guard<std::mutex> lock(mainThreadJobsMutex);
+	mainThreadJobs.push_back(new Job{ std::move(task), counter, Logger::threadHistory });
+}
+
+void JobSystem::RunMainThreadJobs() {
+	std::vector<Job*> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainThreadJobsMutex);
+		jobs.swap(mainThreadJobs);
+	}
+	for (auto job: jobs) {
+		Execute(job);
+	}
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	while (!counter.IsDone()) {
+		if (IsMainThread()) {
+			RunMainThreadJobs();
+		}
+
+		Job* job = FindJob();
+		if (job) {
+			Execute(job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+int JobSystem::GetCurrentThreadIndex() const {
+	if (currentJobSystem == this) {
+		return currentWorkerIndex;
+	}
+	return std::this_thread::get_id() == mainThreadId ? 0 : -1;
+}
+
+int JobSystem::GetDefaultGrainSize(int count) const {
+	// Around 4 chunks per thread, never less than 256 elements so the job overhead stays small
+	const int numThreads = static_cast<int>(deques.size());
+	return std::max(256, count / (numThreads * 4) + 1);
+}
+
+void JobSystem::Enqueue(Job* job) {
+	const int dequeIndex = GetCurrentThreadIndex();
+	if (dequeIndex >= 0) {
+		if (!deques[dequeIndex]->Push(job)) {
+			// The local deque is full, run it right away instead of waiting for room
+			Execute(job);
+			return;
+		}
+	} else {
+		std::lock_guard<std::mutex> lock(injectedJobsMutex);
+		injectedJobs.push_back(job);
+	}
+
+	const int depth = queuedJobs.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+	// The peak is only written when it grows, most enqueues just read it
+	int peak = peakQueuedJobs.load(std::memory_order_relaxed);
+	while (depth > peak && !peakQueuedJobs.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+	}
+
+	WakeWorker();
+}
+
+void JobSystem::WakeWorker() {
+	// Taking the lock makes sure a worker that is about to sleep sees the new job
+	if (sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+		}
+		wakeCondition.notify_one();
+	}
+}
+
+Job* JobSystem::FindJob() {
+	const int numDeques = static_cast<int>(deques.size());
+	const int dequeIndex = GetCurrentThreadIndex();
+	Job* job = nullptr;
+
+	// First our own deque, newest job first since its data is probably still in cache
+	if (dequeIndex >= 0) {
+		job = deques[dequeIndex]->Pop();
+	}
+
+	// Then steal the oldest job of a random victim
+	if (!job) {
+		if (stealSeed == 0) {
+			stealSeed = static_cast<uint32_t>(dequeIndex + 2) * 2654435761u;
+		}
+		stealSeed ^= stealSeed << 13;
+		stealSeed ^= stealSeed >> 17;
+		stealSeed ^= stealSeed << 5;
+
+		const int start = static_cast<int>(stealSeed % numDeques);
+		for (int i = 0; i < numDeques && !job; i++) {
+			const int victim = (start + i) % numDeques;
+			if (victim != dequeIndex) {
+				job = deques[victim]->Steal();
+			}
+		}
+	}
+
+	// Finally the jobs scheduled from outside the job system
+	if (!job) {
+		std::lock_guard<std::mutex> lock(injectedJobsMutex);
+		if (!injectedJobs.empty()) {
+			job = injectedJobs.back();
+			injectedJobs.pop_back();
+		}
+	}
+
+	if (job) {
+		queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+void JobSystem::Execute(Job* job) {
+	// A worker waiting inside a job of one world can pick up a job of another one, the logs follow the job
+	LogHistory* previousHistory = Logger::threadHistory;
+	Logger::threadHistory = job->logHistory;
+	job->task();
+	Logger::threadHistory = previousHistory;
+	if (job->counter) {
+		job->counter->value.fetch_sub(1, std::memory_order_release);
+	}
+	delete job;
+}
+
+void JobSystem::WorkerLoop(int workerIndex) {
+	currentJobSystem = this;
+	currentWorkerIndex = workerIndex;
+	PROFILE_THREAD("Worker " + std::to_string(workerIndex));
+	AllocationTracker::SetFrameThread(true);
+
+	while (isRunning) {
+		Job* job = FindJob();
+		if (job) {
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		wakeCondition.wait(lock, [this]() {
+			return queuedJobs.load(std::memory_order_seq_cst) > 0 || !isRunning;
+		});
+		sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../Profiler/Profiler.h"
+
+// A counter is incremented for every job scheduled against it and decremented when the job finishes
+// Waiting on it blocks until all of those jobs are done
+struct JobCounter {
+	std::atomic<int> value{ 0 };
+
+	bool IsDone() const {
+		return value.load(std::memory_order_acquire) == 0;
+	}
+};
+
+class LogHistory;
+
+struct Job {
+	std::function<void()> task;
+	JobCounter* counter;
+
+	// Log history of the thread that scheduled the job, the job logs there on whatever thread runs it
+	LogHistory* logHistory;
+};
+
+// Chase-Lev work stealing deque with a fixed capacity
+// Only the owner thread calls Push() and Pop() on the bottom, any other thread can Steal() from the top
+class JobDeque {
+private:
+	static const int64_t CAPACITY = 4096;
+	static const int64_t MASK = CAPACITY - 1;
+
+	std::atomic<int64_t> top{ 0 };
+	std::atomic<int64_t> bottom{ 0 };
+	std::atomic<Job*> buffer[CAPACITY];
+public:
+	JobDeque();
+
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+	int GetSize() const;
+};
+
+class JobSystem {
+private:
+	// Index 0 belongs to the main thread, the workers use 1..numWorkers
+	std::vector<std::unique_ptr<JobDeque>> deques;
+	std::vector<std::thread> workers;
+	std::thread::id mainThreadId;
+	std::atomic<bool> isRunning{ false };
+
+	// Jobs scheduled from threads that don't own a deque
+	std::mutex injectedJobsMutex;
+	std::vector<Job*> injectedJobs;
+
+	// Jobs that have to run on the main thread, like anything that touches SDL
+	std::mutex mainThreadJobsMutex;
+	std::vector<Job*> mainThreadJobs;
+
+	// Idle workers sleep here until there is something to do
+	std::atomic<int> queuedJobs{ 0 };
+	std::atomic<int> peakQueuedJobs{ 0 };
+	std::atomic<int> sleepingWorkers{ 0 };
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+
+	void WorkerLoop(int workerIndex);
+	void Enqueue(Job* job);
+	void WakeWorker();
+	Job* FindJob();
+	void Execute(Job* job);
+public:
+	// numWorkers = 0 uses one worker per hardware thread, minus the main thread
+	JobSystem(int numWorkers = 0);
+	~JobSystem();
+
+	int GetNumWorkers() const;
+	int GetQueuedJobs() const;
+
+	// Most jobs queued at the same time since the last call, the game samples it once per frame
+	int TakePeakQueuedJobs();
+	bool IsMainThread() const;
+
+	void Schedule(std::function<void()> task, JobCounter* counter = nullptr);
+	void ScheduleOnMainThread(std::function<void()> task, JobCounter* counter = nullptr);
+
+	// Runs every job queued for the main thread, the game loop calls this once per frame
+	void RunMainThreadJobs();
+
+	// Helps executing jobs until the counter reaches zero instead of blocking the calling thread
+	void Wait(JobCounter& counter);
+
+	// 0 for the main thread, 1..numWorkers for the workers, -1 for threads this job system doesn't own (workers of another one included)
+	int GetCurrentThreadIndex() const;
+
+	// Chunk size used when the caller doesn't pick one, big enough to amortize the job but leaving a few chunks per thread to balance the load
+	int GetDefaultGrainSize(int count) const;
+
+	// Splits [0, count) into chunks of grainSize elements and calls func(begin, end) for each one across the workers
+	template <typename TFunc> void ParallelFor(int count, int grainSize, TFunc func);
+
+	// Same as ParallelFor but every chunk accumulates into its own local value, the locals are combined in chunk order with reduce at the end
+	template <typename T, typename TFunc, typename TReduce> T ParallelReduce(int count, int grainSize, T identity, TFunc func, TReduce reduce);
+};
+
+// Keeps every chunk accumulator on its own cache line
+template <typename T>
+struct alignas(64) ChunkLocalValue {
+	T value;
+};
+
+template <typename TFunc>
+void JobSystem::ParallelFor(int count, int grainSize, TFunc func) {
+	if (count <= 0) {
+		return;
+	}
+	if (grainSize <= 0) {
+		grainSize = GetDefaultGrainSize(count);
+	}
+
+	// Not worth a job, run it right here
+	if (count <= grainSize) {
+		func(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (int begin = 0; begin < count; begin += grainSize) {
+		const int end = std::min(begin + grainSize, count);
+		Schedule([&func, begin, end]() {
+			PROFILE_ZONE("ParallelFor chunk");
+			func(begin, end);
+		}, &counter);
+	}
+	Wait(counter);
+}
+
+template <typename T, typename TFunc, typename TReduce>
+T JobSystem::ParallelReduce(int count, int grainSize, T identity, TFunc func, TReduce reduce) {
+	if (count <= 0) {
+		return identity;
+	}
+	if (grainSize <= 0) {
+		grainSize = GetDefaultGrainSize(count);
+	}
+
+	// One slot per chunk rather than per thread: chunks also run on the thread that waits, which may not belong to the job system
+	const int numChunks = (count + grainSize - 1) / grainSize;
+	std::vector<ChunkLocalValue<T>> locals(numChunks, ChunkLocalValue<T>{ identity });
+
+	ParallelFor(count, grainSize, [&locals, &func, grainSize](int begin, int end) {
+		func(begin, end, locals[begin / grainSize].value);
+	});
+
+	T total = identity;
+	for (auto& local: locals) {
+		total = reduce(total, local.value);
+	}
+	return total;
+}
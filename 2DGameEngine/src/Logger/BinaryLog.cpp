@@ -0,0 +1,283 @@
+#include "BinaryLog.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free, "The entry format id is published in place");
+
+std::mutex BinaryLog::formatsMutex;
+std::vector<BinaryLogFormat> BinaryLog::formats;
+char* BinaryLog::mappedMemory = nullptr;
+uint64_t BinaryLog::capacity = 0;
+std::atomic<uint64_t> BinaryLog::writeOffset{ 0 };
+std::atomic<uint64_t> BinaryLog::droppedEntries{ 0 };
+std::string BinaryLog::filePath;
+std::atomic<int> BinaryLog::level{ LOG_DEBUG };
+#ifdef _WIN32
+void* BinaryLog::fileHandle = nullptr;
+void* BinaryLog::mappingHandle = nullptr;
+#else
+int BinaryLog::fileDescriptor = -1;
+#endif
+
+static uint64_t SteadyNanosecs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t BinaryLog::GetArgSize(const char* arg) {
+	return 2 + std::min(std::strlen(arg), MAX_STRING_LENGTH);
+}
+
+size_t BinaryLog::GetArgSize(char* arg) {
+	return GetArgSize(static_cast<const char*>(arg));
+}
+
+size_t BinaryLog::GetArgSize(const std::string& arg) {
+	return 2 + std::min(arg.size(), MAX_STRING_LENGTH);
+}
+
+char* BinaryLog::PackArg(char* out, const char* arg) {
+	const uint16_t length = static_cast<uint16_t>(std::min(std::strlen(arg), MAX_STRING_LENGTH));
+	std::memcpy(out, &length, sizeof(length));
+	std::memcpy(out + sizeof(length), arg, length);
+	return out + sizeof(length) + length;
+}
+
+char* BinaryLog::PackArg(char* out, char* arg) {
+	return PackArg(out, static_cast<const char*>(arg));
+}
+
+char* BinaryLog::PackArg(char* out, const std::string& arg) {
+	return PackArg(out, arg.c_str());
+}
+
+bool BinaryLog::Open(const std::string& filePath, uint64_t capacityBytes) {
+	Close();
+	capacityBytes = std::max<uint64_t>(capacityBytes, sizeof(BinaryLogFileHeader) + 4096);
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		Logger::Err("Error opening binary log file: " + filePath);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(capacityBytes >> 32), static_cast<DWORD>(capacityBytes), nullptr);
+	void* memory = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+	if (!memory) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		Logger::Err("Error mapping binary log file: " + filePath);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+#else
+	int file = open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		Logger::Err("Error opening binary log file: " + filePath);
+		return false;
+	}
+	void* memory = ftruncate(file, static_cast<off_t>(capacityBytes)) == 0 ? mmap(nullptr, capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+	if (memory == MAP_FAILED) {
+		close(file);
+		Logger::Err("Error mapping binary log file: " + filePath);
+		return false;
+	}
+	fileDescriptor = file;
+#endif
+
+	// Touching every page now keeps the page faults out of the logging calls
+	std::memset(memory, 0, capacityBytes);
+
+	BinaryLogFileHeader header = {};
+	std::memcpy(header.magic, "2DBL", 4);
+	header.version = VERSION;
+	header.capacity = capacityBytes;
+	header.wallClockNanosecs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	header.steadyClockNanosecs = SteadyNanosecs();
+	std::memcpy(memory, &header, sizeof(header));
+
+	BinaryLog::filePath = filePath;
+	capacity = capacityBytes;
+	writeOffset = sizeof(BinaryLogFileHeader);
+	droppedEntries = 0;
+
+	// Formats registered before the file was opened still need their definitions in it
+	std::lock_guard<std::mutex> lock(formatsMutex);
+	mappedMemory = static_cast<char*>(memory);
+	for (size_t i = 0; i < formats.size(); i++) {
+		WriteFormatDefinition(static_cast<uint32_t>(i + 1), formats[i]);
+	}
+
+	Logger::Log("Binary log opened: " + filePath);
+	return true;
+}
+
+void BinaryLog::Close() {
+	if (!mappedMemory) {
+		return;
+	}
+	char* memory = mappedMemory;
+	mappedMemory = nullptr;
+	const uint64_t usedBytes = std::min(writeOffset.load(), capacity);
+
+#ifdef _WIN32
+	FlushViewOfFile(memory, 0);
+	UnmapViewOfFile(memory);
+	CloseHandle(mappingHandle);
+	LARGE_INTEGER size;
+	size.QuadPart = static_cast<LONGLONG>(usedBytes);
+	SetFilePointerEx(fileHandle, size, nullptr, FILE_BEGIN);
+	SetEndOfFile(fileHandle);
+	CloseHandle(fileHandle);
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	munmap(memory, capacity);
+	if (ftruncate(fileDescriptor, static_cast<off_t>(usedBytes)) != 0) {
+		Logger::Err("Error trimming binary log file: " + filePath);
+	}
+	close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+
+	const uint64_t dropped = droppedEntries.load();
+	Logger::Log("Binary log closed: " + filePath + ", " + std::to_string(usedBytes / 1024) + " KB");
+	if (dropped > 0) {
+		Logger::Err("Binary log dropped " + std::to_string(dropped) + " entries, the file was full");
+	}
+}
+
+uint64_t BinaryLog::GetDroppedEntries() {
+	return droppedEntries.load(std::memory_order_relaxed);
+}
+
+void BinaryLog::SetLevel(LogType level) {
+	BinaryLog::level.store(level, std::memory_order_relaxed);
+}
+
+uint32_t BinaryLog::RegisterFormat(LogType level, LogCategory category, const char* format, std::string argTypes) {
+	std::lock_guard<std::mutex> lock(formatsMutex);
+
+	// Two threads can reach the same call site before its id is stored, they share the first registration
+	for (size_t i = 0; i < formats.size(); i++) {
+		if (formats[i].format == format && formats[i].argTypes == argTypes && formats[i].level == level && formats[i].category == category) {
+			return static_cast<uint32_t>(i + 1);
+		}
+	}
+	formats.push_back(BinaryLogFormat{ level, category, format, std::move(argTypes) });
+	const uint32_t formatId = static_cast<uint32_t>(formats.size());
+	if (mappedMemory) {
+		WriteFormatDefinition(formatId, formats.back());
+	}
+	return formatId;
+}
+
+char* BinaryLog::Reserve(uint32_t payloadSize) {
+	// Entries stay 8 byte aligned so the headers can be read and published in place
+	const uint64_t entrySize = (sizeof(BinaryLogEntryHeader) + payloadSize + 7) & ~uint64_t{ 7 };
+	const uint64_t offset = writeOffset.fetch_add(entrySize, std::memory_order_relaxed);
+	if (offset + entrySize > capacity) {
+		droppedEntries.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	char* entry = mappedMemory + offset;
+	BinaryLogEntryHeader* header = reinterpret_cast<BinaryLogEntryHeader*>(entry);
+	header->size = static_cast<uint32_t>(sizeof(BinaryLogEntryHeader) + payloadSize);
+	header->timestamp = SteadyNanosecs();
+	return entry;
+}
+
+void BinaryLog::Publish(char* entry, uint32_t formatId) {
+	reinterpret_cast<std::atomic<uint32_t>*>(entry)->store(formatId, std::memory_order_release);
+}
+
+void BinaryLog::WriteFormatDefinition(uint32_t formatId, const BinaryLogFormat& format) {
+	// id, level, category, argument count, argument types, format length, format
+	const uint16_t numArgs = static_cast<uint16_t>(format.argTypes.size());
+	const uint16_t formatLength = static_cast<uint16_t>(std::min<size_t>(format.format.size(), UINT16_MAX));
+	const uint32_t payloadSize = 4 + 1 + 1 + 2 + numArgs + 2 + formatLength;
+
+	char* entry = Reserve(payloadSize);
+	if (!entry) {
+		return;
+	}
+	char* out = entry + sizeof(BinaryLogEntryHeader);
+	const uint8_t level = static_cast<uint8_t>(format.level);
+	const uint8_t category = static_cast<uint8_t>(format.category);
+	std::memcpy(out, &formatId, 4); out += 4;
+	std::memcpy(out, &level, 1); out += 1;
+	std::memcpy(out, &category, 1); out += 1;
+	std::memcpy(out, &numArgs, 2); out += 2;
+	std::memcpy(out, format.argTypes.data(), numArgs); out += numArgs;
+	std::memcpy(out, &formatLength, 2); out += 2;
+	std::memcpy(out, format.format.data(), formatLength);
+	Publish(entry, FORMAT_DEFINITION_ID);
+}
+
+void BinaryLog::WriteText(uint32_t formatId, const char* payload, size_t size) {
+	BinaryLogFormat format;
+	{
+		std::lock_guard<std::mutex> lock(formatsMutex);
+		format = formats[formatId - 1];
+	}
+	Logger::Write(format.level, format.category, FormatMessage(format.format, format.argTypes, payload, size));
+}
+
+std::string BinaryLog::FormatMessage(const std::string& format, const std::string& argTypes, const char* payload, size_t size) {
+	std::string message;
+	size_t offset = 0;
+	size_t nextArg = 0;
+	for (size_t i = 0; i < format.size(); i++) {
+		if (format[i] != '{' || i + 1 >= format.size() || format[i + 1] != '}') {
+			message += format[i];
+			continue;
+		}
+		i++;
+		if (nextArg >= argTypes.size()) {
+			message += "{}";
+			continue;
+		}
+
+		// A truncated entry prints what it has and marks the rest
+		auto read = [&](void* value, size_t valueSize) {
+			if (offset + valueSize > size) {
+				offset = size + 1;
+				return false;
+			}
+			std::memcpy(value, payload + offset, valueSize);
+			offset += valueSize;
+			return true;
+		};
+		switch (argTypes[nextArg++]) {
+			case BINARY_LOG_INT32: { int32_t value; if (read(&value, 4)) message += std::to_string(value); break; }
+			case BINARY_LOG_UINT32: { uint32_t value; if (read(&value, 4)) message += std::to_string(value); break; }
+			case BINARY_LOG_INT64: { int64_t value; if (read(&value, 8)) message += std::to_string(value); break; }
+			case BINARY_LOG_UINT64: { uint64_t value; if (read(&value, 8)) message += std::to_string(value); break; }
+			case BINARY_LOG_DOUBLE: { double value; if (read(&value, 8)) message += std::to_string(value); break; }
+			case BINARY_LOG_BOOL: { uint8_t value; if (read(&value, 1)) message += value ? "true" : "false"; break; }
+			case BINARY_LOG_STRING: {
+				uint16_t length;
+				if (read(&length, 2) && offset + length <= size) {
+					message.append(payload + offset, length);
+					offset += length;
+				}
+				break;
+			}
+		}
+		if (offset > size) {
+			message += "<truncated>";
+		}
+	}
+	return message;
+}
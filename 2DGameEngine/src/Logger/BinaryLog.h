@@ -0,0 +1,203 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Logger.h"
+
+// Binary log sink: an entry is a format id, a timestamp and the raw bytes of the arguments, appended to a memory mapped file
+// The format strings are written to the same file the first time they are used, tools/LogDecoder turns the file back into text
+// LOG_BIN(LOG_DEBUG, LOG_CATEGORY_ECS, "Entity {} created", entityId) falls back to a text log while no file is open
+// The file is meant for release builds too, so only the binary log level filters it; the text fallback is filtered like the text macros
+#define LOG_BIN(level, category, format, ...) \
+	do { \
+		static std::atomic<uint32_t> binaryLogFormatId{ 0 }; \
+		if (BinaryLog::IsOpen()) { \
+			if (BinaryLog::IsEnabled((level))) { \
+				BinaryLog::Write(binaryLogFormatId, (level), (category), format, ##__VA_ARGS__); \
+			} \
+		} else if constexpr ((level) >= LOG_COMPILE_LEVEL) { \
+			if (Logger::IsEnabled((level), (category))) { \
+				BinaryLog::Write(binaryLogFormatId, (level), (category), format, ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+// Argument type codes stored with the format, strings are a 16 bit length followed by the characters
+enum BinaryLogArg : char {
+	BINARY_LOG_INT32 = 'i',
+	BINARY_LOG_UINT32 = 'u',
+	BINARY_LOG_INT64 = 'I',
+	BINARY_LOG_UINT64 = 'U',
+	BINARY_LOG_DOUBLE = 'd',
+	BINARY_LOG_BOOL = 'b',
+	BINARY_LOG_STRING = 's'
+};
+
+struct BinaryLogFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t capacity;
+
+	// Wall clock and steady clock read at the same moment, the entries only carry the steady clock
+	int64_t wallClockNanosecs;
+	uint64_t steadyClockNanosecs;
+};
+
+// The writer fills the size and the timestamp first and publishes the entry by storing its format id last
+// A zero size marks the end of the log, a zero format id with a size is an entry that was reserved but never finished
+struct BinaryLogEntryHeader {
+	uint32_t formatId;
+	// Header included, so it is never zero once the entry is reserved
+	uint32_t size;
+	uint64_t timestamp;
+};
+
+struct BinaryLogFormat {
+	LogType level;
+	LogCategory category;
+	std::string format;
+	std::string argTypes;
+};
+
+class BinaryLog {
+public:
+	static constexpr uint32_t VERSION = 2;
+	static constexpr uint32_t FORMAT_DEFINITION_ID = 0xFFFFFFFF;
+
+	// Strings longer than this are cut, it keeps the fallback buffer on the stack
+	static constexpr size_t MAX_STRING_LENGTH = 256;
+private:
+	static std::mutex formatsMutex;
+	static std::vector<BinaryLogFormat> formats;
+
+	static char* mappedMemory;
+	static uint64_t capacity;
+	static std::atomic<uint64_t> writeOffset;
+	static std::atomic<uint64_t> droppedEntries;
+	static std::string filePath;
+	static std::atomic<int> level;
+#ifdef _WIN32
+	static void* fileHandle;
+	static void* mappingHandle;
+#else
+	static int fileDescriptor;
+#endif
+
+	static uint32_t RegisterFormat(LogType level, LogCategory category, const char* format, std::string argTypes);
+	static char* Reserve(uint32_t payloadSize);
+	static void Publish(char* entry, uint32_t formatId);
+	static void WriteFormatDefinition(uint32_t formatId, const BinaryLogFormat& format);
+	static void WriteText(uint32_t formatId, const char* payload, size_t size);
+
+	template <typename T> static constexpr char GetArgType();
+	template <typename T> static size_t GetArgSize(const T& arg);
+	template <typename T> static char* PackArg(char* out, const T& arg);
+	static size_t GetArgSize(const char* arg);
+	static size_t GetArgSize(char* arg);
+	static size_t GetArgSize(const std::string& arg);
+	static char* PackArg(char* out, const char* arg);
+	static char* PackArg(char* out, char* arg);
+	static char* PackArg(char* out, const std::string& arg);
+public:
+	// Maps a file of capacityBytes, entries that don't fit anymore are dropped and counted
+	static bool Open(const std::string& filePath, uint64_t capacityBytes = 64ull << 20);
+
+	// Unmaps the file and trims it to what was written, nothing may be logging to it anymore
+	static void Close();
+	static bool IsOpen() {
+		return mappedMemory != nullptr;
+	}
+	static uint64_t GetDroppedEntries();
+
+	// Entries below this level are not written to the file, everything is by default
+	static void SetLevel(LogType level);
+	static bool IsEnabled(LogType level) {
+		return level >= BinaryLog::level.load(std::memory_order_relaxed);
+	}
+
+	template <typename ...TArgs>
+	static void Write(std::atomic<uint32_t>& formatId, LogType level, LogCategory category, const char* format, const TArgs& ...args);
+
+	// Renders a format with its packed arguments, {} is replaced by the next argument (shared with the decoder)
+	static std::string FormatMessage(const std::string& format, const std::string& argTypes, const char* payload, size_t size);
+};
+
+template <typename T>
+constexpr char BinaryLog::GetArgType() {
+	using Type = std::decay_t<T>;
+	if constexpr (std::is_same_v<Type, bool>) {
+		return BINARY_LOG_BOOL;
+	} else if constexpr (std::is_floating_point_v<Type>) {
+		return BINARY_LOG_DOUBLE;
+	} else if constexpr (std::is_integral_v<Type> || std::is_enum_v<Type>) {
+		if constexpr (sizeof(Type) <= 4) {
+			return std::is_signed_v<Type> ? BINARY_LOG_INT32 : BINARY_LOG_UINT32;
+		} else {
+			return std::is_signed_v<Type> ? BINARY_LOG_INT64 : BINARY_LOG_UINT64;
+		}
+	} else {
+		static_assert(std::is_same_v<Type, std::string> || std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>, "Unsupported binary log argument type");
+		return BINARY_LOG_STRING;
+	}
+}
+
+template <typename T>
+size_t BinaryLog::GetArgSize(const T&) {
+	switch (GetArgType<T>()) {
+		case BINARY_LOG_INT32: case BINARY_LOG_UINT32: return 4;
+		case BINARY_LOG_BOOL: return 1;
+		default: return 8;
+	}
+}
+
+template <typename T>
+char* BinaryLog::PackArg(char* out, const T& arg) {
+	constexpr char type = GetArgType<T>();
+	if constexpr (type == BINARY_LOG_BOOL) {
+		*out = arg ? 1 : 0;
+		return out + 1;
+	} else if constexpr (type == BINARY_LOG_DOUBLE) {
+		const double value = static_cast<double>(arg);
+		std::memcpy(out, &value, sizeof(value));
+		return out + sizeof(value);
+	} else if constexpr (type == BINARY_LOG_INT32 || type == BINARY_LOG_UINT32) {
+		const uint32_t value = static_cast<uint32_t>(arg);
+		std::memcpy(out, &value, sizeof(value));
+		return out + sizeof(value);
+	} else {
+		const uint64_t value = static_cast<uint64_t>(arg);
+		std::memcpy(out, &value, sizeof(value));
+		return out + sizeof(value);
+	}
+}
+
+template <typename ...TArgs>
+void BinaryLog::Write(std::atomic<uint32_t>& formatId, LogType level, LogCategory category, const char* format, const TArgs& ...args) {
+	uint32_t id = formatId.load(std::memory_order_acquire);
+	if (id == 0) {
+		id = RegisterFormat(level, category, format, std::string{ GetArgType<TArgs>()... });
+		formatId.store(id, std::memory_order_release);
+	}
+
+	const size_t payloadSize = (size_t{ 0 } + ... + GetArgSize(args));
+	if (!IsOpen()) {
+		// No file, the arguments are packed on the stack and printed through the text logger
+		char payload[sizeof...(TArgs) * (MAX_STRING_LENGTH + 2) + 1];
+		char* out = payload;
+		((out = PackArg(out, args)), ...);
+		WriteText(id, payload, payloadSize);
+		return;
+	}
+
+	char* entry = Reserve(static_cast<uint32_t>(payloadSize));
+	if (!entry) {
+		return;
+	}
+	char* out = entry + sizeof(BinaryLogEntryHeader);
+	((out = PackArg(out, args)), ...);
+	Publish(entry, id);
+}
@@ -1,10 +1,59 @@
 #include "./Logger.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include <algorithm>
 #include <string>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
-std::string CurrentDateTimeToString() {
+// static member variables are expected to be defined as well
+LogHistory Logger::history;
+thread_local LogHistory* Logger::threadHistory = nullptr;
+bool Logger::isEnabled = true;
+LogSlot Logger::queue[QUEUE_CAPACITY];
+std::atomic<uint64_t> Logger::enqueuePosition{ 0 };
+std::atomic<uint64_t> Logger::writtenPosition{ 0 };
+std::atomic<uint64_t> Logger::droppedMessages{ 0 };
+std::atomic<bool> Logger::isThreadRunning{ false };
+LogOverflowPolicy Logger::overflowPolicy = LOG_OVERFLOW_BLOCK;
+LogType Logger::categoryLevels[LOG_CATEGORY_COUNT] = { LOG_DEBUG, LOG_DEBUG, LOG_DEBUG, LOG_DEBUG, LOG_DEBUG };
+
+static std::thread writerThread;
+static std::once_flag writerStartFlag;
+
+// Serializes the writes made without the writer thread, before it starts and after it stopped
+static std::mutex directWriteMutex;
+
+// Set under directWriteMutex once the writer is joined, from then on the producers drain the queue themselves
+static bool isWriterJoined = false;
+
+// Constant initialized, so it stays readable while the other statics are being destroyed
+static bool areStaticsDestroyed = false;
+
+// WriteEntry's buffers are defined ahead of loggerShutdown, function statics would be destroyed before the last messages
+// The time string only changes once per second, most messages reuse it
+static std::time_t cachedTime = -1;
+static std::string cachedTimeString;
+
+// The line keeps its capacity from one message to the next
+static std::string entryLine;
+
+// Joins the writer when the program exits, so nothing queued is lost
+// Statics of other files can still log from their destructors after this one: those messages skip the queue and the
+// history (which may be gone already) and are printed straight away
+struct LoggerShutdown {
+	~LoggerShutdown() {
+		Logger::Shutdown();
+		areStaticsDestroyed = true;
+	}
+};
+static LoggerShutdown loggerShutdown;
+
+std::string CurrentDateTimeToString(std::time_t now) {
 
 	// this function from the course triggers an error for using localtime
 	/*std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
@@ -12,12 +61,15 @@ std::string CurrentDateTimeToString() {
 	std::strftime(&output[0], output.size(), "%d-%b-%y %H:%M:%S", std::localtime(&now));
 	return output;*/
 
-	std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 	std::tm tm_snapshot;
 	char buffer[30]; // Temp buffer to hold the datetime string.
 
-	// Use localtime_s instead of localtime.
+	// Use localtime_s instead of localtime, localtime_r is the POSIX equivalent
+#ifdef _WIN32
 	localtime_s(&tm_snapshot, &now);
+#else
+	localtime_r(&now, &tm_snapshot);
+#endif
 
 	// Write the time and date to the buffer
 	std::strftime(buffer, sizeof(buffer), "%d-%b-%y %H:%M:%S", &tm_snapshot);
@@ -25,19 +77,323 @@ std::string CurrentDateTimeToString() {
 	return std::string(buffer); // Constructing string from buffer
 }
 
-// static member variables are expected to be defined as well
-std::vector<LogEntry> Logger::messages;
+// Formats, prints and stores one message, only ever called by one thread at a time
+static void WriteEntry(LogType type, LogCategory category, int64_t timeMillisecs, LogHistory* history, const char* text, size_t length) {
+	static const char* prefixes[] = { "DBG: [", "LOG: [", "WRN: [", "ERR: [" };
+	static const char* colors[] = { "\x1B[90m", "\x1B[32m", "\x1B[93m", "\x1B[91m" };
+
+	const std::time_t time = static_cast<std::time_t>(timeMillisecs / 1000);
+	if (time != cachedTime) {
+		cachedTime = time;
+		cachedTimeString = CurrentDateTimeToString(time);
+	}
+
+	entryLine.clear();
+	entryLine += colors[type];
+	entryLine += prefixes[type];
+	entryLine += cachedTimeString;
+	entryLine += "] ";
+	if (category != LOG_CATEGORY_GENERAL) {
+		entryLine += "[";
+		entryLine += Logger::GetCategoryName(category);
+		entryLine += "] ";
+	}
+	entryLine.append(text, length);
+	entryLine += "\033[0m\n";
+	std::cout << entryLine;
+
+	// The history keeps the bare message, the time and type are stored next to it
+	(history ? *history : Logger::history).Add(type, category, timeMillisecs, text, length);
+}
+
+void Logger::SetEnabled(bool enabled) {
+	isEnabled = enabled;
+}
 void Logger::Log(const std::string& message) {
-	LogEntry logEntry;
-	logEntry.type = LOG_INFO;
-	logEntry.message = "LOG: [" + CurrentDateTimeToString() + "] " + message;
-	std::cout << "\x1B[32m" << logEntry.message << "\033[0m" << std::endl;
-	messages.push_back(logEntry);
+	if (!isEnabled) {
+		return;
+	}
+	FlightRecorder::RecordLog(LOG_INFO, message);
+	Enqueue(LOG_INFO, LOG_CATEGORY_GENERAL, message);
 }
 void Logger::Err(const std::string& message) {
-	LogEntry logEntry;
-	logEntry.type = LOG_ERROR;
-	logEntry.message = "ERR: [" + CurrentDateTimeToString() + "] " + message;
-	std::cout << "\x1B[91m" << logEntry.message<< "\033[0m" << std::endl;
-	messages.push_back(logEntry);
-}
\ No newline at end of file
+	if (!isEnabled) {
+		return;
+	}
+	FlightRecorder::RecordLog(LOG_ERROR, message);
+	Enqueue(LOG_ERROR, LOG_CATEGORY_GENERAL, message);
+}
+void Logger::Write(LogType level, LogCategory category, const std::string& message) {
+	if (!IsEnabled(level, category)) {
+		return;
+	}
+	FlightRecorder::RecordLog(level, message);
+	Enqueue(level, category, message);
+}
+void Logger::SetCategoryLevel(LogCategory category, LogType level) {
+	categoryLevels[category] = level;
+}
+const char* Logger::GetCategoryName(LogCategory category) {
+	static const char* names[LOG_CATEGORY_COUNT] = { "General", "ECS", "Assets", "Jobs", "Game" };
+	return names[category];
+}
+
+void Logger::Enqueue(LogType type, LogCategory category, const std::string& message) {
+	if (areStaticsDestroyed) {
+		static const char* prefixes[] = { "DBG: ", "LOG: ", "WRN: ", "ERR: " };
+		std::fputs(prefixes[type], stdout);
+		std::fwrite(message.data(), 1, message.size(), stdout);
+		std::fputc('\n', stdout);
+		std::fflush(stdout);
+		return;
+	}
+
+	std::call_once(writerStartFlag, []() {
+		for (uint64_t i = 0; i < QUEUE_CAPACITY; i++) {
+			queue[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		isThreadRunning = true;
+		writerThread = std::thread(WriterLoop);
+	});
+
+	const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	const bool isTruncated = message.size() > LogSlot::MAX_LENGTH;
+	const size_t length = isTruncated ? LogSlot::MAX_LENGTH : message.size();
+
+	// Once the writer is joined there is nobody to hand the message to, while it is still finishing it keeps taking them
+	if (!isThreadRunning.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(directWriteMutex);
+		if (isWriterJoined) {
+			DrainQueue();
+			WriteEntry(type, category, now, threadHistory, message.data(), message.size());
+			std::cout.flush();
+			return;
+		}
+	}
+
+	uint64_t position = enqueuePosition.load(std::memory_order_relaxed);
+	LogSlot* slot;
+	for (;;) {
+		slot = &queue[position % QUEUE_CAPACITY];
+		const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+		if (difference == 0) {
+			// seq_cst pairs with Shutdown(): either the writer or the drain sees this slot, or the check below sees the writer gone
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// Full, the writer hasn't released this slot yet
+			if (overflowPolicy == LOG_OVERFLOW_DROP) {
+				droppedMessages.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			std::this_thread::yield();
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		} else {
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->type = type;
+	slot->category = category;
+	slot->timeMillisecs = now;
+	slot->history = threadHistory;
+	slot->length = static_cast<uint16_t>(length);
+	if (isTruncated) {
+		const size_t textLength = LogSlot::MAX_LENGTH - LogSlot::TRUNCATION_MARKER_LENGTH;
+		std::memcpy(slot->text, message.data(), textLength);
+		std::memcpy(slot->text + textLength, LogSlot::TRUNCATION_MARKER, LogSlot::TRUNCATION_MARKER_LENGTH);
+	} else {
+		std::memcpy(slot->text, message.data(), length);
+	}
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	// The writer may have drained and exited between the running check above and the reservation, nobody would write this slot
+	// While Shutdown() is still joining it, its own drain after the join picks the slot up
+	if (!isThreadRunning.load(std::memory_order_seq_cst)) {
+		std::lock_guard<std::mutex> lock(directWriteMutex);
+		if (isWriterJoined) {
+			DrainQueue();
+			std::cout.flush();
+		}
+	}
+}
+
+void Logger::DrainQueue() {
+	// Only called once the writer is joined, with directWriteMutex held, so nobody else consumes the slots
+	uint64_t position = writtenPosition.load(std::memory_order_acquire);
+	while (position < enqueuePosition.load(std::memory_order_seq_cst)) {
+		LogSlot& slot = queue[position % QUEUE_CAPACITY];
+
+		// Reserved but not published yet, the producer is between its reservation and its store
+		while (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+			std::this_thread::yield();
+		}
+		WriteEntry(slot.type, slot.category, slot.timeMillisecs, slot.history, slot.text, slot.length);
+		slot.sequence.store(position + QUEUE_CAPACITY, std::memory_order_release);
+		position++;
+		writtenPosition.store(position, std::memory_order_release);
+	}
+}
+
+void Logger::WriterLoop() {
+	uint64_t position = 0;
+	uint64_t reportedDrops = 0;
+	for (;;) {
+		LogSlot& slot = queue[position % QUEUE_CAPACITY];
+		if (slot.sequence.load(std::memory_order_acquire) == position + 1) {
+			WriteEntry(slot.type, slot.category, slot.timeMillisecs, slot.history, slot.text, slot.length);
+
+			// Hands the slot back to the producers for the next lap around the ring
+			slot.sequence.store(position + QUEUE_CAPACITY, std::memory_order_release);
+			position++;
+			writtenPosition.store(position, std::memory_order_release);
+			continue;
+		}
+
+		// Nothing left for now, this is the only place the output gets flushed
+		const uint64_t drops = droppedMessages.load(std::memory_order_relaxed);
+		if (drops != reportedDrops) {
+			const std::string dropMessage = std::to_string(drops - reportedDrops) + " log messages dropped, the queue was full";
+			const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			WriteEntry(LOG_ERROR, LOG_CATEGORY_GENERAL, now, nullptr, dropMessage.data(), dropMessage.size());
+			reportedDrops = drops;
+		}
+		std::cout.flush();
+
+		if (!isThreadRunning.load(std::memory_order_acquire) && position == enqueuePosition.load(std::memory_order_acquire)) {
+			return;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void Logger::SetOverflowPolicy(LogOverflowPolicy policy) {
+	overflowPolicy = policy;
+}
+
+uint64_t Logger::GetDroppedMessages() {
+	return droppedMessages.load(std::memory_order_relaxed);
+}
+
+void Logger::Flush() {
+	const uint64_t target = enqueuePosition.load(std::memory_order_acquire);
+	while (isThreadRunning.load(std::memory_order_acquire) && writtenPosition.load(std::memory_order_acquire) < target) {
+		std::this_thread::yield();
+	}
+}
+
+void Logger::Shutdown() {
+	if (!isThreadRunning.exchange(false)) {
+		return;
+	}
+	if (writerThread.joinable()) {
+		writerThread.join();
+	}
+
+	// Whatever was reserved while the writer was leaving
+	std::lock_guard<std::mutex> lock(directWriteMutex);
+	isWriterJoined = true;
+	DrainQueue();
+	std::cout.flush();
+}
+
+LogHistory::LogHistory(size_t maxMessages, size_t arenaBytes) {
+	records.resize(std::max<size_t>(maxMessages, 1));
+	arena.resize(std::max<size_t>(arenaBytes, 1));
+}
+
+void LogHistory::EvictOverlapping(size_t begin, size_t end) {
+	// The text is written in the same order as the records, so the oldest records are the first ones in the way
+	// Empty records hold no text, they don't stop the search and are only forgotten along with a newer record in the way
+	for (uint64_t i = firstRecord; i < nextRecord; i++) {
+		const Record& record = records[i % records.size()];
+		if (record.length == 0) {
+			continue;
+		}
+		if (record.offset >= end || record.offset + record.length <= begin) {
+			return;
+		}
+		firstRecord = i + 1;
+	}
+}
+
+void LogHistory::Add(LogType type, LogCategory category, int64_t timeMillisecs, const char* text, size_t length) {
+	std::lock_guard<std::mutex> lock(mutex);
+	length = std::min(length, arena.size());
+
+	if (nextRecord - firstRecord == records.size()) {
+		firstRecord++;
+	}
+
+	// Not enough room before the end of the arena, the tail is given up and the text starts over at the beginning
+	if (arenaHead + length > arena.size()) {
+		EvictOverlapping(arenaHead, arena.size());
+		arenaHead = 0;
+	}
+	EvictOverlapping(arenaHead, arenaHead + length);
+
+	std::copy(text, text + length, arena.begin() + arenaHead);
+	records[nextRecord % records.size()] = Record{ type, category, timeMillisecs, static_cast<uint32_t>(arenaHead), static_cast<uint32_t>(length) };
+	nextRecord++;
+	arenaHead += length;
+}
+
+void LogHistory::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	firstRecord = nextRecord;
+	arenaHead = 0;
+}
+
+size_t LogHistory::GetSize() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return static_cast<size_t>(nextRecord - firstRecord);
+}
+
+uint64_t LogHistory::GetNumForgotten() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return firstRecord;
+}
+
+size_t LogHistory::GetMemoryUsage() const {
+	return records.capacity() * sizeof(Record) + arena.capacity();
+}
+
+bool LogHistory::Matches(const Record& record, const LogHistoryFilter& filter) {
+	return record.type >= filter.minType &&
+		(filter.category < 0 || record.category == filter.category) &&
+		record.timeMillisecs >= filter.fromMillisecs && record.timeMillisecs <= filter.toMillisecs;
+}
+
+void LogHistory::ForEach(const LogHistoryFilter& filter, const std::function<void(const LogEntry& entry)>& func) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	LogEntry entry;
+	for (uint64_t i = firstRecord; i < nextRecord; i++) {
+		const Record& record = records[i % records.size()];
+		if (!Matches(record, filter)) {
+			continue;
+		}
+		entry.type = record.type;
+		entry.category = record.category;
+		entry.timeMillisecs = record.timeMillisecs;
+		entry.message.assign(arena.data() + record.offset, record.length);
+		func(entry);
+	}
+}
+
+std::vector<LogEntry> LogHistory::Query(const LogHistoryFilter& filter, size_t maxResults) const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Walks back from the newest message so only the requested ones get copied
+	std::vector<LogEntry> result;
+	for (uint64_t i = nextRecord; i > firstRecord && result.size() < maxResults; i--) {
+		const Record& record = records[(i - 1) % records.size()];
+		if (!Matches(record, filter)) {
+			continue;
+		}
+		result.push_back(LogEntry{ record.type, record.category, record.timeMillisecs, std::string(arena.data() + record.offset, record.length) });
+	}
+	std::reverse(result.begin(), result.end());
+	return result;
+}
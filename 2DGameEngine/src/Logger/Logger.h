@@ -1,19 +1,162 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 
-enum LogType{LOG_INFO, LOG_WARNING, LOG_ERROR};
+// Also the log levels, ordered from the most verbose
+enum LogType{LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERROR};
+
+// Every levelled message belongs to a category, each category has its own runtime level
+enum LogCategory{LOG_CATEGORY_GENERAL, LOG_CATEGORY_ECS, LOG_CATEGORY_ASSETS, LOG_CATEGORY_JOBS, LOG_CATEGORY_GAME, LOG_CATEGORY_COUNT};
+
+// Messages below this level are compiled out, release builds drop the debug ones unless the level is set by the build
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL LOG_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_DEBUG
+#endif
+#endif
+
+// LOG_DBG(LOG_CATEGORY_ECS, "Entity " + std::to_string(id)) only builds the message when the entry is going to be logged
+// Below the compile level the whole call is discarded, otherwise it costs one branch on the category level
+#define LOG_AT(level, category, message) \
+	do { \
+		if constexpr ((level) >= LOG_COMPILE_LEVEL) { \
+			if (Logger::IsEnabled((level), (category))) { \
+				Logger::Write((level), (category), (message)); \
+			} \
+		} \
+	} while (0)
+#define LOG_DBG(category, ...) LOG_AT(LOG_DEBUG, category, (__VA_ARGS__))
+#define LOG_INF(category, ...) LOG_AT(LOG_INFO, category, (__VA_ARGS__))
+#define LOG_WRN(category, ...) LOG_AT(LOG_WARNING, category, (__VA_ARGS__))
+#define LOG_ERR(category, ...) LOG_AT(LOG_ERROR, category, (__VA_ARGS__))
 
 struct LogEntry {
 	LogType type;
+	LogCategory category;
+	int64_t timeMillisecs;
 	std::string message;
 };
 
+// Which history entries a query returns, the default matches everything
+struct LogHistoryFilter {
+	LogType minType = LOG_DEBUG;
+	int category = -1;
+	int64_t fromMillisecs = INT64_MIN;
+	int64_t toMillisecs = INT64_MAX;
+};
+
+// Fixed size message history: the records live in a ring and their text in a circular arena of bytes
+// Adding a message never allocates, the oldest messages are forgotten when either the ring or the arena is full
+class LogHistory {
+private:
+	struct Record {
+		LogType type;
+		LogCategory category;
+		int64_t timeMillisecs;
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	std::vector<Record> records;
+	std::vector<char> arena;
+
+	// Absolute record counters, the ring slot is the counter modulo the capacity
+	uint64_t firstRecord = 0;
+	uint64_t nextRecord = 0;
+	size_t arenaHead = 0;
+
+	// The logger thread adds while the game queries
+	mutable std::mutex mutex;
+
+	void EvictOverlapping(size_t begin, size_t end);
+	static bool Matches(const Record& record, const LogHistoryFilter& filter);
+public:
+	LogHistory(size_t maxMessages = 4096, size_t arenaBytes = 1 << 20);
+
+	void Add(LogType type, LogCategory category, int64_t timeMillisecs, const char* text, size_t length);
+	void Clear();
+
+	size_t GetSize() const;
+	uint64_t GetNumForgotten() const;
+	size_t GetMemoryUsage() const;
+
+	// Calls func from the oldest to the newest matching message, the text is only valid during the call
+	void ForEach(const LogHistoryFilter& filter, const std::function<void(const LogEntry& entry)>& func) const;
+
+	// Copies the newest maxResults matching messages, oldest first
+	std::vector<LogEntry> Query(const LogHistoryFilter& filter, size_t maxResults = SIZE_MAX) const;
+};
+
+// What Log() does when the queue is full
+enum LogOverflowPolicy{LOG_OVERFLOW_DROP, LOG_OVERFLOW_BLOCK};
+
+// One queued message, the producer copies the text in and the logger thread formats it
+struct LogSlot {
+	// Longer messages are cut and end with TRUNCATION_MARKER so the reader knows the text goes on
+	static const int MAX_LENGTH = 240;
+	static constexpr const char* TRUNCATION_MARKER = "...";
+	static const int TRUNCATION_MARKER_LENGTH = 3;
+
+	std::atomic<uint64_t> sequence;
+	LogType type;
+	LogCategory category;
+	uint16_t length;
+	int64_t timeMillisecs;
+	LogHistory* history;
+	char text[MAX_LENGTH];
+};
+
 class Logger {
+private:
+	// Bounded multi producer single consumer ring, every slot carries a sequence number telling whose turn it is
+	static const uint64_t QUEUE_CAPACITY = 4096;
+	static LogSlot queue[QUEUE_CAPACITY];
+	static std::atomic<uint64_t> enqueuePosition;
+	static std::atomic<uint64_t> writtenPosition;
+	static std::atomic<uint64_t> droppedMessages;
+	static std::atomic<bool> isThreadRunning;
+	static LogOverflowPolicy overflowPolicy;
+	static LogType categoryLevels[LOG_CATEGORY_COUNT];
+
+	static void Enqueue(LogType type, LogCategory category, const std::string& message);
+	static void WriterLoop();
+	static void DrainQueue();
 public:
-	static std::vector<LogEntry> messages;
+	static LogHistory history;
+
+	// When set, the messages logged on this thread are stored here instead of the shared history (each world keeps its own log)
+	// Jobs carry the history of the thread that scheduled them, so the parallel chunks of a world log into the same one
+	static thread_local LogHistory* threadHistory;
 
+	// Turns every log off, used by the benchmarks so the output doesn't drown the numbers
+	static bool isEnabled;
+	static void SetEnabled(bool enabled);
+
+	// Log() and Err() only copy the message into the queue, a background thread adds the time, prints it and fills the history
 	static void Log(const std::string& message);
 	static void Err(const std::string& message);
+
+	// Levelled logging, mostly used through the LOG_DBG/LOG_INF/LOG_WRN/LOG_ERR macros
+	static void Write(LogType level, LogCategory category, const std::string& message);
+	static bool IsEnabled(LogType level, LogCategory category) {
+		return isEnabled && level >= categoryLevels[category];
+	}
+	static void SetCategoryLevel(LogCategory category, LogType level);
+	static const char* GetCategoryName(LogCategory category);
+
+	static void SetOverflowPolicy(LogOverflowPolicy policy);
+	static uint64_t GetDroppedMessages();
+
+	// Waits until everything logged so far is printed and in the history
+	static void Flush();
+
+	// Drains the queue and stops the thread, later messages are written right away on the calling thread
+	static void Shutdown();
 };
 
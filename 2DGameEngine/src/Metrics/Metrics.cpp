@@ -0,0 +1,265 @@
+#include "Metrics.h"
+#include "Percentile.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+std::mutex Metrics::metricsMutex;
+std::map<std::string, std::unique_ptr<MetricCounter>> Metrics::counters;
+std::map<std::string, std::unique_ptr<MetricGauge>> Metrics::gauges;
+std::map<std::string, std::unique_ptr<MetricHistogram>> Metrics::histograms;
+std::thread Metrics::exportThread;
+std::mutex Metrics::exportMutex;
+std::condition_variable Metrics::exportCondition;
+bool Metrics::isExporting = false;
+
+int MetricHistogram::GetBucket(double value) {
+	if (value <= 0.0) {
+		return 0;
+	}
+	const int bucket = static_cast<int>(std::floor((std::log2(value) - MIN_EXPONENT) * BUCKETS_PER_OCTAVE));
+	return std::min(std::max(bucket, 0), NUM_BUCKETS - 1);
+}
+
+double MetricHistogram::GetBucketValue(int bucket) {
+	// Middle of the bucket on the log scale
+	return std::exp2((bucket + 0.5) / BUCKETS_PER_OCTAVE + MIN_EXPONENT);
+}
+
+void MetricHistogram::Record(double value) {
+	buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+
+	// No fetch_add for doubles in C++17, the loops only retry when two threads record at the same time
+	double currentSum = sum.load(std::memory_order_relaxed);
+	while (!sum.compare_exchange_weak(currentSum, currentSum + value, std::memory_order_relaxed)) {}
+	double currentMax = max.load(std::memory_order_relaxed);
+	while (value > currentMax && !max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {}
+}
+
+MetricHistogramSnapshot MetricHistogram::TakeSnapshot() {
+	MetricHistogramSnapshot snapshot;
+	uint32_t counts[NUM_BUCKETS];
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+		counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+		snapshot.count += counts[i];
+	}
+	count.store(0, std::memory_order_relaxed);
+	snapshot.sum = sum.exchange(0.0, std::memory_order_relaxed);
+	snapshot.max = max.exchange(0.0, std::memory_order_relaxed);
+	if (snapshot.count == 0) {
+		return snapshot;
+	}
+
+	double* values[] = { &snapshot.p50, &snapshot.p95, &snapshot.p99 };
+	const double percentiles[] = { 50.0, 95.0, 99.0 };
+	for (int i = 0; i < 3; i++) {
+		const size_t bucket = GetPercentileBucket(counts, NUM_BUCKETS, snapshot.count, percentiles[i]);
+		*values[i] = std::min(GetBucketValue(static_cast<int>(bucket)), snapshot.max);
+	}
+	return snapshot;
+}
+
+MetricCounter& Metrics::GetCounter(const std::string& name) {
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	auto& counter = counters[name];
+	if (!counter) {
+		counter = std::make_unique<MetricCounter>();
+	}
+	return *counter;
+}
+
+MetricGauge& Metrics::GetGauge(const std::string& name) {
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	auto& gauge = gauges[name];
+	if (!gauge) {
+		gauge = std::make_unique<MetricGauge>();
+	}
+	return *gauge;
+}
+
+MetricHistogram& Metrics::GetHistogram(const std::string& name) {
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	auto& histogram = histograms[name];
+	if (!histogram) {
+		histogram = std::make_unique<MetricHistogram>();
+	}
+	return *histogram;
+}
+
+std::string Metrics::TakeStatsdLines() {
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	std::ostringstream lines;
+	for (auto& counter: counters) {
+		lines << counter.first << ":" << counter.second->TakeValue() << "|c\n";
+	}
+	for (auto& gauge: gauges) {
+		lines << gauge.first << ":" << gauge.second->GetValue() << "|g\n";
+	}
+	for (auto& histogram: histograms) {
+		const MetricHistogramSnapshot snapshot = histogram.second->TakeSnapshot();
+		lines << histogram.first << ".count:" << snapshot.count << "|c\n";
+		if (snapshot.count == 0) {
+			continue;
+		}
+		lines << histogram.first << ".avg:" << snapshot.sum / snapshot.count << "|g\n";
+		lines << histogram.first << ".max:" << snapshot.max << "|g\n";
+		lines << histogram.first << ".p50:" << snapshot.p50 << "|g\n";
+		lines << histogram.first << ".p95:" << snapshot.p95 << "|g\n";
+		lines << histogram.first << ".p99:" << snapshot.p99 << "|g\n";
+	}
+	return lines.str();
+}
+
+#ifdef _WIN32
+typedef SOCKET UdpSocket;
+static const UdpSocket INVALID_UDP_SOCKET = INVALID_SOCKET;
+#else
+typedef int UdpSocket;
+static const UdpSocket INVALID_UDP_SOCKET = -1;
+#endif
+
+// Resolved by StartExport() before the export thread starts, the thread only reads it
+static bool isUdpTarget = false;
+static sockaddr_storage udpDestination;
+static int udpDestinationLength = 0;
+
+// Splits udp://host[:port] and resolves the host, names like localhost included
+static bool ResolveUdpTarget(const std::string& target) {
+	std::string host = target.substr(std::string("udp://").size());
+	std::string port = "8125";
+	const size_t colon = host.rfind(':');
+	if (colon != std::string::npos) {
+		port = host.substr(colon + 1);
+		host = host.substr(0, colon);
+	}
+
+	char* portEnd = nullptr;
+	const long portNumber = std::strtol(port.c_str(), &portEnd, 10);
+	if (host.empty() || port.empty() || *portEnd != '\0' || portNumber < 1 || portNumber > 65535) {
+		Logger::Err("Invalid metrics target: " + target + ", expected udp://host[:port]");
+		return false;
+	}
+
+#ifdef _WIN32
+	static bool isWinsockStarted = false;
+	if (!isWinsockStarted) {
+		WSADATA wsaData;
+		isWinsockStarted = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+	}
+#endif
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0 || !addresses) {
+		Logger::Err("Could not resolve the metrics host: " + host);
+		return false;
+	}
+	// statsd usually only listens on IPv4, localhost can resolve to ::1 first
+	const addrinfo* chosen = addresses;
+	for (const addrinfo* address = addresses; address; address = address->ai_next) {
+		if (address->ai_family == AF_INET) {
+			chosen = address;
+			break;
+		}
+	}
+	std::memcpy(&udpDestination, chosen->ai_addr, chosen->ai_addrlen);
+	udpDestinationLength = static_cast<int>(chosen->ai_addrlen);
+	freeaddrinfo(addresses);
+	return true;
+}
+
+// Sends the lines in datagrams that fit a common MTU, a line is never split
+static void SendUdp(const std::string& lines) {
+	UdpSocket udpSocket = socket(udpDestination.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (udpSocket == INVALID_UDP_SOCKET) {
+		return;
+	}
+
+	const size_t MAX_DATAGRAM = 1400;
+	size_t begin = 0;
+	while (begin < lines.size()) {
+		size_t end = begin;
+		while (end < lines.size()) {
+			const size_t lineEnd = lines.find('\n', end) + 1;
+			if (lineEnd - begin > MAX_DATAGRAM && end > begin) {
+				break;
+			}
+			end = lineEnd;
+		}
+		sendto(udpSocket, lines.data() + begin, static_cast<int>(end - begin), 0, reinterpret_cast<const sockaddr*>(&udpDestination), udpDestinationLength);
+		begin = end;
+	}
+
+#ifdef _WIN32
+	closesocket(udpSocket);
+#else
+	close(udpSocket);
+#endif
+}
+
+void Metrics::ExportLoop(std::string target, double intervalSecs) {
+	bool isLastExport = false;
+	while (!isLastExport) {
+		{
+			std::unique_lock<std::mutex> lock(exportMutex);
+			exportCondition.wait_for(lock, std::chrono::duration<double>(intervalSecs), [] { return !isExporting; });
+			isLastExport = !isExporting;
+		}
+
+		const std::string lines = TakeStatsdLines();
+		if (isUdpTarget) {
+			SendUdp(lines);
+		} else {
+			std::ofstream file(target, std::ios::app);
+			file << lines;
+		}
+	}
+}
+
+bool Metrics::StartExport(const std::string& target, double intervalSecs) {
+	StopExport();
+	if (intervalSecs <= 0.0) {
+		Logger::Err("Invalid metrics export interval: " + std::to_string(intervalSecs));
+		return false;
+	}
+	isUdpTarget = target.compare(0, 6, "udp://") == 0;
+	if (isUdpTarget && !ResolveUdpTarget(target)) {
+		return false;
+	}
+	isExporting = true;
+	exportThread = std::thread(ExportLoop, target, intervalSecs);
+	Logger::Log("Exporting metrics to " + target + " every " + std::to_string(intervalSecs) + " s");
+	return true;
+}
+
+void Metrics::StopExport() {
+	{
+		std::lock_guard<std::mutex> lock(exportMutex);
+		isExporting = false;
+	}
+	exportCondition.notify_all();
+	if (exportThread.joinable()) {
+		exportThread.join();
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Counters, gauges and histograms updated with a few atomic operations, exported in the statsd line format
+// Looking a metric up by name takes a lock, so callers keep the returned reference (a static local or a member)
+// and the update itself stays well under a microsecond
+
+class MetricCounter {
+private:
+	std::atomic<uint64_t> value{ 0 };
+public:
+	void Add(uint64_t amount = 1) {
+		value.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	// Returns what was added since the last call, statsd counters are deltas
+	uint64_t TakeValue() {
+		return value.exchange(0, std::memory_order_relaxed);
+	}
+};
+
+class MetricGauge {
+private:
+	std::atomic<double> value{ 0.0 };
+public:
+	void Set(double newValue) {
+		value.store(newValue, std::memory_order_relaxed);
+	}
+	double GetValue() const {
+		return value.load(std::memory_order_relaxed);
+	}
+};
+
+struct MetricHistogramSnapshot {
+	uint64_t count = 0;
+	double sum = 0.0;
+	double max = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+};
+
+// Logarithmic buckets, 8 per power of two from 2^-10 to 2^30, so a percentile is within about 5% of the real value
+class MetricHistogram {
+private:
+	static const int BUCKETS_PER_OCTAVE = 8;
+	static const int MIN_EXPONENT = -10;
+	static const int NUM_BUCKETS = 40 * BUCKETS_PER_OCTAVE;
+
+	std::atomic<uint32_t> buckets[NUM_BUCKETS] = {};
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<double> sum{ 0.0 };
+	std::atomic<double> max{ 0.0 };
+
+	static int GetBucket(double value);
+	static double GetBucketValue(int bucket);
+public:
+	void Record(double value);
+
+	// Percentiles of the values recorded since the last snapshot, the histogram starts over afterwards
+	MetricHistogramSnapshot TakeSnapshot();
+};
+
+class Metrics {
+private:
+	static std::mutex metricsMutex;
+	static std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+	static std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+	static std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+
+	static std::thread exportThread;
+	static std::mutex exportMutex;
+	static std::condition_variable exportCondition;
+	static bool isExporting;
+
+	static void ExportLoop(std::string target, double intervalSecs);
+public:
+	// The same name always returns the same metric, the references stay valid for the whole program
+	static MetricCounter& GetCounter(const std::string& name);
+	static MetricGauge& GetGauge(const std::string& name);
+	static MetricHistogram& GetHistogram(const std::string& name);
+
+	// Every metric as statsd lines (name:value|c, name:value|g), histograms become .count, .avg, .max, .p50, .p95 and .p99
+	static std::string TakeStatsdLines();
+
+	// Sends the metrics every intervalSecs from a background thread, the target is a file (appended) or udp://host[:port]
+	// The host is resolved here, an invalid target logs an error and returns false without starting the thread
+	static bool StartExport(const std::string& target, double intervalSecs);
+
+	// Sends one last batch and stops the thread
+	static void StopExport();
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Nearest rank percentiles, shared by the frame time histogram, the metric histograms, the stress test and the benchmarks
+// percentile goes from 0 to 100, the result is always one of the recorded values (or buckets)
+
+// Rank of the percentile among count values, from 1 to count
+inline uint64_t GetPercentileRank(double percentile, uint64_t count) {
+	const uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+	return std::min(std::max<uint64_t>(rank, 1), count);
+}
+
+// Samples sorted in ascending order, 0 when there are none
+inline double GetPercentile(const std::vector<double>& sorted, double percentile) {
+	if (sorted.empty()) {
+		return 0.0;
+	}
+	return sorted[GetPercentileRank(percentile, sorted.size()) - 1];
+}
+
+// Index of the bucket holding the percentile out of total counts, numBuckets when the buckets are empty
+template <typename TCount>
+size_t GetPercentileBucket(const TCount* counts, size_t numBuckets, uint64_t total, double percentile) {
+	if (total == 0) {
+		return numBuckets;
+	}
+	const uint64_t rank = GetPercentileRank(percentile, total);
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < numBuckets; i++) {
+		cumulative += counts[i];
+		if (cumulative >= rank) {
+			return i;
+		}
+	}
+	return numBuckets;
+}
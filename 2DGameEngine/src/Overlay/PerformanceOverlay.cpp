@@ -0,0 +1,151 @@
+#include "PerformanceOverlay.h"
+#include "../Logger/Logger.h"
+#include "../Profiler/Profiler.h"
+#include "../Stress/StressTest.h"
+#include "../Systems/RenderSystem.h"
+#include <imgui/imgui.h>
+#include <imgui/imgui_sdl.h>
+#include <algorithm>
+
+PerformanceOverlay::PerformanceOverlay(SDL_Renderer* renderer, int windowWidth, int windowHeight, double refreshMillisecs): refreshMillisecs(refreshMillisecs) {
+	frameMillisecs.resize(FRAME_HISTORY, 0.0f);
+	performanceFrequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+	ImGui::CreateContext();
+	ImGui::GetIO().DisplaySize = ImVec2(static_cast<float>(windowWidth), static_cast<float>(windowHeight));
+	ImGuiSDL::Initialize(renderer, windowWidth, windowHeight);
+
+	Logger::Log("PerformanceOverlay constructor called.");
+}
+
+PerformanceOverlay::~PerformanceOverlay() {
+	ImGuiSDL::Deinitialize();
+	ImGui::DestroyContext();
+
+	Logger::Err("PerformanceOverlay destructor called");
+}
+
+void PerformanceOverlay::Toggle() {
+	isVisible = !isVisible;
+}
+
+bool PerformanceOverlay::IsVisible() const {
+	return isVisible;
+}
+
+void PerformanceOverlay::RecordFrame(double millisecs) {
+	frameMillisecs[frameOffset] = static_cast<float>(millisecs);
+	frameOffset = (frameOffset + 1) % FRAME_HISTORY;
+}
+
+void PerformanceOverlay::SetMemoryRefreshInterval(double millisecs) {
+	memoryRefreshMillisecs = millisecs;
+}
+
+void PerformanceOverlay::Render(const Registry& registry, const AssetBank& assetBank, const FramePacer& framePacer) {
+	if (!isVisible) {
+		return;
+	}
+	PROFILE_ZONE("PerformanceOverlay::Render");
+
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const double millisecsSinceRefresh = (now - lastRefresh) * 1000.0 / performanceFrequency;
+	if (!hasDrawData || millisecsSinceRefresh >= refreshMillisecs) {
+		ImGui::GetIO().DeltaTime = static_cast<float>(std::max(millisecsSinceRefresh, 1.0) / 1000.0);
+		Build(registry, assetBank, framePacer);
+		buildMillisecs = (SDL_GetPerformanceCounter() - now) * 1000.0 / performanceFrequency;
+		lastRefresh = now;
+		hasDrawData = true;
+	}
+
+	ImGuiSDL::Render(ImGui::GetDrawData());
+}
+
+void PerformanceOverlay::Build(const Registry& registry, const AssetBank& assetBank, const FramePacer& framePacer) {
+	ImGui::NewFrame();
+
+	// The overlay never takes input, so the game doesn't need to forward any event
+	ImGui::SetNextWindowPos(ImVec2(10, 10));
+	ImGui::SetNextWindowBgAlpha(0.75f);
+	ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_AlwaysAutoResize);
+
+	// Frame times
+	const FrameTimeHistogram& histogram = framePacer.GetHistogram();
+	const float lastFrame = frameMillisecs[(frameOffset + FRAME_HISTORY - 1) % FRAME_HISTORY];
+	ImGui::Text("Frame: %.2f ms (%.0f fps)", lastFrame, lastFrame > 0.0f ? 1000.0f / lastFrame : 0.0f);
+	ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f ms, missed %llu",
+		histogram.GetPercentile(50), histogram.GetPercentile(95), histogram.GetPercentile(99),
+		static_cast<unsigned long long>(framePacer.GetMissedFrames()));
+	ImGui::PlotLines("##frames", frameMillisecs.data(), FRAME_HISTORY, frameOffset, nullptr, 0.0f, 50.0f, ImVec2(300, 60));
+
+	// Systems
+	ImGui::Separator();
+	ImGui::Columns(4, "systems");
+	ImGui::Text("System"); ImGui::NextColumn();
+	ImGui::Text("Entities"); ImGui::NextColumn();
+	ImGui::Text("Last ms"); ImGui::NextColumn();
+	ImGui::Text("Avg ms"); ImGui::NextColumn();
+	int rows = 0;
+	for (auto system: registry.GetSystems()) {
+		if (rows++ >= MAX_ROWS) {
+			break;
+		}
+		ImGui::Text("%s", system->GetName().c_str()); ImGui::NextColumn();
+		ImGui::Text("%d", system->GetNumEntities()); ImGui::NextColumn();
+		ImGui::Text("%.3f", system->GetLastUpdateMillisecs()); ImGui::NextColumn();
+		ImGui::Text("%.3f", system->GetAverageUpdateMillisecs()); ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+
+	// Component pools
+	ImGui::Separator();
+	ImGui::Text("Entities: %d", registry.GetNumEntities());
+	if (registry.HasSystem<RenderSystem>()) {
+		const SpriteBatch& spriteBatch = registry.GetSystem<RenderSystem>().GetSpriteBatch();
+		ImGui::Text("Sprites: %d in %d draw calls, %s sort", spriteBatch.GetNumSprites(), spriteBatch.GetNumDrawCalls(), spriteBatch.GetRenderQueue().WasLastSortIncremental() ? "incremental" : "radix");
+	}
+	const Uint64 now = SDL_GetPerformanceCounter();
+	if (!hasMemoryStats || (now - lastMemoryRefresh) * 1000.0 / performanceFrequency >= memoryRefreshMillisecs) {
+		memoryStats = registry.GetMemoryStats();
+		lastMemoryRefresh = now;
+		hasMemoryStats = true;
+	}
+	ImGui::Columns(4, "pools");
+	ImGui::Text("Pool"); ImGui::NextColumn();
+	ImGui::Text("Live"); ImGui::NextColumn();
+	ImGui::Text("Holes"); ImGui::NextColumn();
+	ImGui::Text("KB"); ImGui::NextColumn();
+	rows = 0;
+	for (const auto& pool: memoryStats.pools) {
+		if (rows++ >= MAX_ROWS) {
+			break;
+		}
+		ImGui::Text("%s", pool.componentName.c_str()); ImGui::NextColumn();
+		ImGui::Text("%d", pool.liveCount); ImGui::NextColumn();
+		ImGui::Text("%d", pool.holes); ImGui::NextColumn();
+		ImGui::Text("%.1f", pool.bytes / 1024.0); ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+
+	// Memory
+	ImGui::Separator();
+	ImGui::Text("Registry: %.1f KB, %.0f bytes per entity", memoryStats.totalBytes / 1024.0, memoryStats.bytesPerEntity);
+	ImGui::Text("Textures: %d, %.1f KB", assetBank.GetNumTextures(), assetBank.GetTextureMemoryUsage() / 1024.0);
+	ImGui::Text("Process: %.1f MB", GetProcessMemoryUsage() / (1024.0 * 1024.0));
+	ImGui::Text("Overlay: %.3f ms every %.0f ms", buildMillisecs, refreshMillisecs);
+
+	// Latest problems from the log history
+	LogHistoryFilter problems;
+	problems.minType = LOG_WARNING;
+	const std::vector<LogEntry> entries = Logger::history.Query(problems, MAX_LOG_LINES);
+	if (!entries.empty()) {
+		ImGui::Separator();
+		for (const auto& entry: entries) {
+			const ImVec4 color = entry.type == LOG_ERROR ? ImVec4(1.0f, 0.35f, 0.35f, 1.0f) : ImVec4(1.0f, 0.9f, 0.3f, 1.0f);
+			ImGui::TextColored(color, "%s", entry.message.c_str());
+		}
+	}
+
+	ImGui::End();
+	ImGui::Render();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <SDL.h>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../AssetBank/AssetBank.h"
+#include "../FramePacer/FramePacer.h"
+
+// In game ImGui window with the frame times, the systems, the pools and the memory (toggled with F1)
+// The window is only rebuilt a few times per second, in between we draw the same ImGui draw data again
+class PerformanceOverlay {
+private:
+	static const int FRAME_HISTORY = 240;
+	static const int MAX_ROWS = 32;
+	static const int MAX_LOG_LINES = 6;
+
+	bool isVisible = true;
+	bool hasDrawData = false;
+
+	// Ring buffer of the last frame times for the graph
+	std::vector<float> frameMillisecs;
+	int frameOffset = 0;
+
+	double refreshMillisecs;
+	Uint64 lastRefresh = 0;
+	double performanceFrequency;
+
+	// What building the window cost the last time, shown in the window itself
+	double buildMillisecs = 0.0;
+
+	// Counting the pools walks every entity, so the counts are only taken again every memoryRefreshMillisecs
+	RegistryMemoryStats memoryStats;
+	double memoryRefreshMillisecs = 1000.0;
+	Uint64 lastMemoryRefresh = 0;
+	bool hasMemoryStats = false;
+
+	void Build(const Registry& registry, const AssetBank& assetBank, const FramePacer& framePacer);
+public:
+	PerformanceOverlay(SDL_Renderer* renderer, int windowWidth, int windowHeight, double refreshMillisecs = 250.0);
+	~PerformanceOverlay();
+
+	void Toggle();
+	bool IsVisible() const;
+
+	void RecordFrame(double millisecs);
+
+	// Follows --memory-report when it is set, so the window and the log show the same counts
+	void SetMemoryRefreshInterval(double millisecs);
+
+	// Called every frame before presenting
+	void Render(const Registry& registry, const AssetBank& assetBank, const FramePacer& framePacer);
+};
@@ -0,0 +1,154 @@
+#include "Profiler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+std::atomic<bool> Profiler::isCapturing{ false };
+std::mutex Profiler::buffersMutex;
+std::vector<std::unique_ptr<ProfileThreadBuffer>> Profiler::buffers;
+thread_local ProfileThreadBuffer* Profiler::threadBuffer = nullptr;
+uint32_t Profiler::eventsPerThread = 1 << 16;
+std::atomic<uint32_t> Profiler::captureIndex{ 0 };
+thread_local const char* Profiler::currentZone = nullptr;
+
+uint64_t Profiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProfileThreadBuffer& Profiler::GetThreadBuffer() {
+	if (!threadBuffer) {
+		// First zone of this thread, the only time we need the lock
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		auto newBuffer = std::make_unique<ProfileThreadBuffer>();
+		newBuffer->events.resize(eventsPerThread);
+		newBuffer->captureIndex = captureIndex.load(std::memory_order_relaxed);
+		newBuffer->threadId = static_cast<int>(buffers.size());
+		newBuffer->threadName = "Thread " + std::to_string(newBuffer->threadId);
+		threadBuffer = newBuffer.get();
+		buffers.push_back(std::move(newBuffer));
+	}
+	return *threadBuffer;
+}
+
+void Profiler::BeginCapture(uint32_t eventsPerThread) {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	Profiler::eventsPerThread = eventsPerThread;
+
+	// The workers may be recording right now, their buffers are only swapped by themselves in JoinCapture()
+	// A new size is allocated here so they don't allocate in the middle of a frame
+	for (auto& buffer: buffers) {
+		if (buffer->events.size() != eventsPerThread) {
+			buffer->nextEvents.resize(eventsPerThread);
+		} else {
+			std::vector<ProfileEvent>().swap(buffer->nextEvents);
+		}
+	}
+	captureIndex.fetch_add(1, std::memory_order_release);
+	isCapturing = true;
+}
+
+void Profiler::JoinCapture(ProfileThreadBuffer& buffer, uint32_t captureIndex) {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	if (!buffer.nextEvents.empty()) {
+		buffer.events.swap(buffer.nextEvents);
+		std::vector<ProfileEvent>().swap(buffer.nextEvents);
+	}
+	buffer.count.store(0, std::memory_order_relaxed);
+	buffer.dropped.store(0, std::memory_order_relaxed);
+	buffer.captureIndex = captureIndex;
+}
+
+void Profiler::EndCapture() {
+	isCapturing = false;
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end) {
+	ProfileThreadBuffer& buffer = GetThreadBuffer();
+
+	// First zone of this thread since BeginCapture(), the previous capture's events are dropped
+	const uint32_t currentCapture = captureIndex.load(std::memory_order_acquire);
+	if (buffer.captureIndex != currentCapture) {
+		JoinCapture(buffer, currentCapture);
+	}
+	const uint32_t index = buffer.count.load(std::memory_order_relaxed);
+
+	// Full buffer, keep what we have instead of allocating in the middle of a frame
+	if (index >= buffer.events.size()) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[index] = ProfileEvent{ name, start, end };
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ProfileThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffer.threadName = name;
+}
+
+static std::string EscapeJson(const std::string& text) {
+	std::string result;
+	for (char c: text) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+		}
+		result += c;
+	}
+	return result;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& filePath) {
+	std::ofstream file(filePath);
+	if (!file) {
+		Logger::Err("Error opening profiler trace file: " + filePath);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+
+	// The threads that recorded nothing since BeginCapture() still hold the events of an older capture
+	const uint32_t currentCapture = captureIndex.load(std::memory_order_relaxed);
+	auto getCount = [currentCapture](const ProfileThreadBuffer& buffer) -> uint32_t {
+		return buffer.captureIndex == currentCapture ? buffer.count.load(std::memory_order_acquire) : 0;
+	};
+
+	// Timestamps are relative to the first event so the numbers stay readable
+	uint64_t firstTimestamp = UINT64_MAX;
+	for (auto& buffer: buffers) {
+		const uint32_t count = getCount(*buffer);
+		for (uint32_t i = 0; i < count; i++) {
+			firstTimestamp = std::min(firstTimestamp, buffer->events[i].start);
+		}
+	}
+
+	uint64_t numEvents = 0;
+	uint64_t numDropped = 0;
+	bool isFirst = true;
+	file << "{\"traceEvents\":[\n";
+	for (auto& buffer: buffers) {
+		file << (isFirst ? "" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId;
+		file << ",\"args\":{\"name\":\"" << EscapeJson(buffer->threadName) << "\"}}";
+		isFirst = false;
+
+		const uint32_t count = getCount(*buffer);
+		for (uint32_t i = 0; i < count; i++) {
+			const ProfileEvent& event = buffer->events[i];
+			file << ",\n{\"name\":\"" << EscapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId;
+			file << ",\"ts\":" << (event.start - firstTimestamp) / 1000.0;
+			file << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+		numEvents += count;
+		numDropped += buffer->captureIndex == currentCapture ? buffer->dropped.load(std::memory_order_relaxed) : 0;
+	}
+	file << "\n]}\n";
+
+	Logger::Log("Profiler trace with " + std::to_string(numEvents) + " zones written to " + filePath);
+	if (numDropped > 0) {
+		Logger::Err("Profiler dropped " + std::to_string(numDropped) + " zones, the thread buffers were full");
+	}
+	return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timing zones, only compiled in when ENABLE_PROFILER is defined
+// PROFILE_ZONE("Name") times the enclosing scope, the name must outlive the capture (a literal or a system name)
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#endif
+
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// Every thread writes its zones to its own buffer, so recording never takes a lock
+// The owner thread is the only writer, the exporter only reads the events before count
+// A new capture doesn't touch the buffers of the running threads, each thread resets its own at its next zone
+struct ProfileThreadBuffer {
+	std::vector<ProfileEvent> events;
+	std::atomic<uint32_t> count{ 0 };
+	std::atomic<uint32_t> dropped{ 0 };
+	std::string threadName;
+	int threadId;
+
+	// Capture the events belong to, and the events of the new size BeginCapture() allocated for the next one
+	uint32_t captureIndex = 0;
+	std::vector<ProfileEvent> nextEvents;
+};
+
+class Profiler {
+private:
+	static std::atomic<bool> isCapturing;
+	static std::mutex buffersMutex;
+	static std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+	static thread_local ProfileThreadBuffer* threadBuffer;
+	static uint32_t eventsPerThread;
+	static std::atomic<uint32_t> captureIndex;
+
+	// Innermost zone of the thread, kept even when not capturing so the allocation tracker can attribute allocations
+	static thread_local const char* currentZone;
+
+	static ProfileThreadBuffer& GetThreadBuffer();
+	static void JoinCapture(ProfileThreadBuffer& buffer, uint32_t captureIndex);
+public:
+	// Nanoseconds from a steady clock
+	static uint64_t Now();
+
+	// Starts a new capture and forgets the previous one, eventsPerThread is the fixed size of each thread buffer
+	static void BeginCapture(uint32_t eventsPerThread = 1 << 16);
+	static void EndCapture();
+	static bool IsCapturing() {
+		return isCapturing.load(std::memory_order_relaxed);
+	}
+
+	static void Record(const char* name, uint64_t start, uint64_t end);
+	static void SetThreadName(const std::string& name);
+
+	static const char* GetCurrentZone() {
+		return currentZone;
+	}
+	static const char* EnterZone(const char* name) {
+		const char* parent = currentZone;
+		currentZone = name;
+		return parent;
+	}
+	static void LeaveZone(const char* parent) {
+		currentZone = parent;
+	}
+
+	// Writes the capture in the Chrome trace format (chrome://tracing, ui.perfetto.dev)
+	static bool ExportChromeTrace(const std::string& filePath);
+};
+
+class ProfileZone {
+private:
+	const char* name;
+	const char* parentZone;
+	uint64_t start;
+public:
+	ProfileZone(const char* name): name(name), parentZone(Profiler::EnterZone(name)), start(Profiler::IsCapturing() ? Profiler::Now() : 0) {}
+	~ProfileZone() {
+		if (start != 0) {
+			Profiler::Record(name, start, Profiler::Now());
+		}
+		Profiler::LeaveZone(parentZone);
+	}
+};
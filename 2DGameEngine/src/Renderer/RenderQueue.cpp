@@ -0,0 +1,124 @@
+#include "RenderQueue.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+uint64_t RenderQueue::MakeKey(int layer, uint16_t texture, float depth) {
+	const uint64_t layerBits = static_cast<uint16_t>(std::clamp(layer, -32768, 32767) + 32768);
+
+	// Flips the float bits so they compare as unsigned integers: negative numbers get all their bits flipped, positive ones only the sign
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	depthBits ^= (depthBits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+
+	return (layerBits << 48) | (static_cast<uint64_t>(texture) << 32) | depthBits;
+}
+
+void RenderQueue::Clear() {
+	keys.clear();
+}
+
+void RenderQueue::Push(uint64_t key) {
+	keys.push_back(key);
+}
+
+bool RenderQueue::InsertionFixup(size_t maxMoves) {
+	size_t moves = 0;
+	for (size_t i = 1; i < sortedKeys.size(); i++) {
+		const uint64_t key = sortedKeys[i];
+		if (key >= sortedKeys[i - 1]) {
+			continue;
+		}
+		const int item = order[i];
+		size_t j = i;
+		while (j > 0 && sortedKeys[j - 1] > key) {
+			sortedKeys[j] = sortedKeys[j - 1];
+			order[j] = order[j - 1];
+			j--;
+		}
+		sortedKeys[j] = key;
+		order[j] = item;
+
+		// Both arrays are still a valid permutation here, so the radix sort can carry on from them
+		moves += i - j;
+		if (moves > maxMoves) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void RenderQueue::RadixSort() {
+	const size_t numItems = sortedKeys.size();
+	scratchKeys.resize(numItems);
+	scratchOrder.resize(numItems);
+
+	// The histograms of the 8 digits in one pass over the keys
+	uint32_t counts[8][256] = {};
+	for (uint64_t key: sortedKeys) {
+		for (int digit = 0; digit < 8; digit++) {
+			counts[digit][(key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int digit = 0; digit < 8; digit++) {
+		const int shift = digit * 8;
+
+		// All the keys share this byte, usually the layer and the texture bytes
+		if (counts[digit][(sortedKeys[0] >> shift) & 0xFF] == numItems) {
+			continue;
+		}
+
+		uint32_t offsets[256];
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++) {
+			offsets[bucket] = offset;
+			offset += counts[digit][bucket];
+		}
+		for (size_t i = 0; i < numItems; i++) {
+			const uint32_t destination = offsets[(sortedKeys[i] >> shift) & 0xFF]++;
+			scratchKeys[destination] = sortedKeys[i];
+			scratchOrder[destination] = order[i];
+		}
+		sortedKeys.swap(scratchKeys);
+		order.swap(scratchOrder);
+	}
+}
+
+void RenderQueue::Sort() {
+	PROFILE_ZONE("RenderQueue::Sort");
+	const size_t numItems = keys.size();
+
+	// Same number of items as the last frame: start from the last order, it is most likely sorted or nearly sorted
+	if (numItems > 0 && order.size() == numItems) {
+		for (size_t i = 0; i < numItems; i++) {
+			sortedKeys[i] = keys[order[i]];
+		}
+		lastSortWasIncremental = InsertionFixup(numItems / 8 + 64);
+		if (!lastSortWasIncremental) {
+			RadixSort();
+		}
+		return;
+	}
+
+	order.resize(numItems);
+	std::iota(order.begin(), order.end(), 0);
+	sortedKeys = keys;
+	lastSortWasIncremental = false;
+	if (numItems > 1) {
+		RadixSort();
+	}
+}
+
+const std::vector<int>& RenderQueue::GetOrder() const {
+	return order;
+}
+
+int RenderQueue::GetSize() const {
+	return static_cast<int>(keys.size());
+}
+
+bool RenderQueue::WasLastSortIncremental() const {
+	return lastSortWasIncremental;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sorts the draw items of a frame by a 64 bit key: layer (16 bits), texture (16 bits), depth (32 bits)
+// Most items keep their place from one frame to the next, so the order of the last frame is reused and
+// fixed up with an insertion sort; only when too much has moved it falls back to an LSD radix sort
+class RenderQueue {
+private:
+	// Keys in the order the items were pushed
+	std::vector<uint64_t> keys;
+
+	// Item indices in drawing order and their keys, they are kept between frames
+	std::vector<int> order;
+	std::vector<uint64_t> sortedKeys;
+
+	// Ping-pong buffers of the radix sort
+	std::vector<int> scratchOrder;
+	std::vector<uint64_t> scratchKeys;
+
+	bool lastSortWasIncremental = false;
+
+	bool InsertionFixup(size_t maxMoves);
+	void RadixSort();
+public:
+	RenderQueue() = default;
+
+	// Layers go from -32768 to 32767, lower layers are drawn first; depth breaks ties inside a layer and texture
+	static uint64_t MakeKey(int layer, uint16_t texture, float depth);
+
+	void Clear();
+	void Push(uint64_t key);
+
+	// Equal keys keep the relative order they had in the last frame
+	void Sort();
+
+	// Item indices in drawing order, valid after Sort()
+	const std::vector<int>& GetOrder() const;
+	int GetSize() const;
+	bool WasLastSortIncremental() const;
+};
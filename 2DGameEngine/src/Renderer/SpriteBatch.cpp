@@ -0,0 +1,103 @@
+#include "SpriteBatch.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+void SpriteBatch::Begin() {
+	sprites.clear();
+	numDrawCalls = 0;
+}
+
+void SpriteBatch::Add(SDL_Texture* texture, const glm::vec2& position, const glm::vec2& size, float rotation, int layer, SDL_Color color) {
+	sprites.push_back(SpriteBatchItem{ texture, position, size, rotation, color, layer });
+}
+
+uint16_t SpriteBatch::GetTextureSlot(SDL_Texture* texture) {
+	// There are only a handful of textures and consecutive sprites tend to share one, so a short linear search is enough
+	if (lastTextureSlot >= 0 && textures[lastTextureSlot] == texture) {
+		return static_cast<uint16_t>(lastTextureSlot);
+	}
+	auto it = std::find(textures.begin(), textures.end(), texture);
+	if (it == textures.end()) {
+		// Destroyed textures are never removed, start over if the key runs out of bits
+		if (textures.size() > UINT16_MAX) {
+			textures.clear();
+		}
+		it = textures.insert(textures.end(), texture);
+	}
+	lastTextureSlot = static_cast<int>(it - textures.begin());
+	return static_cast<uint16_t>(lastTextureSlot);
+}
+
+void SpriteBatch::AppendQuad(const SpriteBatchItem& sprite) {
+	const glm::vec2 halfSize = sprite.size * 0.5f;
+	const glm::vec2 center = sprite.position + halfSize;
+	const float radians = glm::radians(sprite.rotation);
+	const float cosine = std::cos(radians);
+	const float sine = std::sin(radians);
+
+	static const glm::vec2 corners[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+	static const SDL_FPoint texCoords[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+	for (int corner = 0; corner < 4; corner++) {
+		const glm::vec2 offset = corners[corner] * halfSize;
+		SDL_Vertex vertex;
+		vertex.position.x = center.x + offset.x * cosine - offset.y * sine;
+		vertex.position.y = center.y + offset.x * sine + offset.y * cosine;
+		vertex.color = sprite.color;
+		vertex.tex_coord = texCoords[corner];
+		vertices.push_back(vertex);
+	}
+}
+
+void SpriteBatch::Flush(SDL_Renderer* renderer) {
+	PROFILE_ZONE("SpriteBatch::Flush");
+	if (sprites.empty()) {
+		return;
+	}
+	// The key groups a layer's sprites by texture before the depth, so the bottom edge order only holds among the
+	// sprites sharing a texture; sprites of different textures that have to overlap properly need different layers
+	renderQueue.Clear();
+	for (const SpriteBatchItem& sprite: sprites) {
+		renderQueue.Push(RenderQueue::MakeKey(sprite.layer, GetTextureSlot(sprite.texture), sprite.position.y + sprite.size.y));
+	}
+	renderQueue.Sort();
+	const std::vector<int>& order = renderQueue.GetOrder();
+
+	vertices.clear();
+	for (int spriteIndex: order) {
+		AppendQuad(sprites[spriteIndex]);
+	}
+
+	// Every quad uses the same 6 indices relative to its first vertex, and every batch starts at its own first vertex
+	for (size_t quad = indices.size() / 6; quad < sprites.size(); quad++) {
+		const int first = static_cast<int>(quad * 4);
+		const int quadIndices[6] = { first, first + 1, first + 2, first + 2, first + 3, first };
+		indices.insert(indices.end(), quadIndices, quadIndices + 6);
+	}
+
+	// Runs of sprites sharing a texture, each one is a single draw call, a run can span several layers
+	size_t runStart = 0;
+	while (runStart < order.size()) {
+		SDL_Texture* texture = sprites[order[runStart]].texture;
+		size_t runEnd = runStart + 1;
+		while (runEnd < order.size() && sprites[order[runEnd]].texture == texture) {
+			runEnd++;
+		}
+		const int numQuads = static_cast<int>(runEnd - runStart);
+		SDL_RenderGeometry(renderer, texture, vertices.data() + runStart * 4, numQuads * 4, indices.data(), numQuads * 6);
+		numDrawCalls++;
+		runStart = runEnd;
+	}
+}
+
+int SpriteBatch::GetNumSprites() const {
+	return static_cast<int>(sprites.size());
+}
+
+int SpriteBatch::GetNumDrawCalls() const {
+	return numDrawCalls;
+}
+
+const RenderQueue& SpriteBatch::GetRenderQueue() const {
+	return renderQueue;
+}
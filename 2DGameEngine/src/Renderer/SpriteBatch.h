@@ -0,0 +1,51 @@
+#pragma once
+#include "RenderQueue.h"
+#include <SDL.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct SpriteBatchItem {
+	SDL_Texture* texture;
+	glm::vec2 position;
+	glm::vec2 size;
+	float rotation;
+	SDL_Color color;
+	int layer;
+};
+
+// Collects the sprites of a frame, sorts them by layer, texture and bottom edge, and draws every run of sprites
+// sharing a texture with one SDL_RenderGeometry call (needs SDL 2.0.18)
+// The buffers keep their capacity between frames, so a frame with the same number of sprites doesn't allocate
+class SpriteBatch {
+private:
+	std::vector<SpriteBatchItem> sprites;
+
+	RenderQueue renderQueue;
+
+	// Textures seen so far, the index is the texture part of the sort key so it has to stay the same between frames
+	std::vector<SDL_Texture*> textures;
+	int lastTextureSlot = -1;
+
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	int numDrawCalls = 0;
+
+	uint16_t GetTextureSlot(SDL_Texture* texture);
+	void AppendQuad(const SpriteBatchItem& sprite);
+public:
+	SpriteBatch() = default;
+
+	void Begin();
+
+	// position is the top left corner before the rotation, rotation is in degrees around the center
+	// Lower layers are drawn first, inside a layer sprites of the same texture further down the screen are drawn on top
+	void Add(SDL_Texture* texture, const glm::vec2& position, const glm::vec2& size, float rotation, int layer = 0, SDL_Color color = { 255, 255, 255, 255 });
+
+	// Draws everything added since Begin()
+	void Flush(SDL_Renderer* renderer);
+
+	int GetNumSprites() const;
+	int GetNumDrawCalls() const;
+	const RenderQueue& GetRenderQueue() const;
+};
@@ -0,0 +1,167 @@
+#include "InputReplay.h"
+#include "../Logger/Logger.h"
+#include <cstring>
+
+static const char REPLAY_MAGIC[4] = { '2', 'D', 'R', 'P' };
+static const uint32_t REPLAY_VERSION = 1;
+
+template <typename T>
+static void WriteValue(std::ofstream& file, const T& value) {
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream& file, T& value) {
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+InputRecorder::InputRecorder() {
+	Logger::Log("InputRecorder constructor called.");
+}
+
+InputRecorder::~InputRecorder() {
+	Close();
+	Logger::Err("InputRecorder destructor called");
+}
+
+bool InputRecorder::Open(const std::string& filePath, double fixedDeltaTime) {
+	file.open(filePath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		Logger::Err("Error opening replay file for recording: " + filePath);
+		return false;
+	}
+
+	file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+	WriteValue(file, REPLAY_VERSION);
+	WriteValue(file, fixedDeltaTime);
+
+	Logger::Log("Recording input to " + filePath);
+	return true;
+}
+
+void InputRecorder::Close() {
+	if (file.is_open()) {
+		file.close();
+		Logger::Log("Recorded " + std::to_string(numFrames) + " frames");
+	}
+}
+
+void InputRecorder::BeginFrame(double frameTime) {
+	this->frameTime = frameTime;
+	frameEvents.clear();
+}
+
+void InputRecorder::RecordEvent(const SDL_Event& sdlEvent) {
+	// Only the events the game reacts to are worth storing
+	switch (sdlEvent.type) {
+		case SDL_QUIT:
+			frameEvents.push_back(RecordedEvent{ 0, sdlEvent.type, 0 });
+			break;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			frameEvents.push_back(RecordedEvent{ sdlEvent.key.timestamp, sdlEvent.type, sdlEvent.key.keysym.sym });
+			break;
+	}
+}
+
+void InputRecorder::EndFrame(uint64_t stateHash) {
+	if (!file.is_open()) {
+		return;
+	}
+
+	// A frame never has more than 255 events worth keeping, anything past that is dropped
+	const uint8_t numEvents = static_cast<uint8_t>(frameEvents.size() < 255 ? frameEvents.size() : 255);
+
+	WriteValue(file, frameTime);
+	WriteValue(file, numEvents);
+	for (uint8_t i = 0; i < numEvents; i++) {
+		WriteValue(file, frameEvents[i].timestamp);
+		WriteValue(file, frameEvents[i].type);
+		WriteValue(file, frameEvents[i].key);
+	}
+	WriteValue(file, stateHash);
+	numFrames++;
+}
+
+InputPlayer::InputPlayer() {
+	Logger::Log("InputPlayer constructor called.");
+}
+
+InputPlayer::~InputPlayer() {
+	if (hasDiverged) {
+		Logger::Err("Replay diverged at frame " + std::to_string(firstDivergentFrame));
+	} else if (numFrames > 0) {
+		Logger::Log("Replay of " + std::to_string(numFrames) + " frames matched the recording");
+	}
+	Logger::Err("InputPlayer destructor called");
+}
+
+bool InputPlayer::Open(const std::string& filePath) {
+	file.open(filePath, std::ios::binary);
+	if (!file) {
+		Logger::Err("Error opening replay file: " + filePath);
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	file.read(magic, sizeof(magic));
+	if (!file || std::memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0 || !ReadValue(file, version) || version != REPLAY_VERSION) {
+		Logger::Err("Invalid replay file: " + filePath);
+		file.close();
+		return false;
+	}
+	ReadValue(file, fixedDeltaTime);
+
+	Logger::Log("Replaying input from " + filePath);
+	return true;
+}
+
+double InputPlayer::GetFixedDeltaTime() const {
+	return fixedDeltaTime;
+}
+
+bool InputPlayer::NextFrame(double& frameTime) {
+	uint8_t numEvents = 0;
+	if (!file.is_open() || !ReadValue(file, frameTime) || !ReadValue(file, numEvents)) {
+		return false;
+	}
+
+	frameEvents.resize(numEvents);
+	for (auto& recordedEvent: frameEvents) {
+		ReadValue(file, recordedEvent.timestamp);
+		ReadValue(file, recordedEvent.type);
+		ReadValue(file, recordedEvent.key);
+	}
+	nextEvent = 0;
+
+	return ReadValue(file, expectedStateHash);
+}
+
+bool InputPlayer::PollEvent(SDL_Event& sdlEvent) {
+	if (nextEvent >= frameEvents.size()) {
+		return false;
+	}
+
+	const auto& recordedEvent = frameEvents[nextEvent++];
+	std::memset(&sdlEvent, 0, sizeof(sdlEvent));
+	sdlEvent.type = recordedEvent.type;
+	if (recordedEvent.type == SDL_KEYDOWN || recordedEvent.type == SDL_KEYUP) {
+		sdlEvent.key.timestamp = recordedEvent.timestamp;
+		sdlEvent.key.keysym.sym = recordedEvent.key;
+	}
+	return true;
+}
+
+void InputPlayer::CheckStateHash(uint64_t stateHash) {
+	if (stateHash != expectedStateHash && !hasDiverged) {
+		hasDiverged = true;
+		firstDivergentFrame = numFrames;
+		Logger::Err("Replay diverged from the recording at frame " + std::to_string(numFrames));
+	}
+	numFrames++;
+}
+
+bool InputPlayer::HasDiverged() const {
+	return hasDiverged;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary replay file:
+// header: "2DRP", uint32 version, double fixedDeltaTime
+// frame:  double frameTime (the time the frame simulated), uint8 numEvents, numEvents * (uint32 timestamp, uint32 type, int32 key), uint64 stateHash
+struct RecordedEvent {
+	uint32_t timestamp;
+	uint32_t type;
+	int32_t key;
+};
+
+// Writes the input and the frame times of a session so it can be played back exactly
+class InputRecorder {
+private:
+	std::ofstream file;
+	std::vector<RecordedEvent> frameEvents;
+	double frameTime = 0.0;
+	uint64_t numFrames = 0;
+public:
+	InputRecorder();
+	~InputRecorder();
+
+	bool Open(const std::string& filePath, double fixedDeltaTime);
+	void Close();
+
+	void BeginFrame(double frameTime);
+	void RecordEvent(const SDL_Event& sdlEvent);
+	void EndFrame(uint64_t stateHash);
+};
+
+// Feeds a recorded session back into the game and checks that the simulation ends every frame in the same state
+class InputPlayer {
+private:
+	std::ifstream file;
+	std::vector<RecordedEvent> frameEvents;
+	size_t nextEvent = 0;
+	double fixedDeltaTime = 0.0;
+	uint64_t expectedStateHash = 0;
+	uint64_t numFrames = 0;
+	uint64_t firstDivergentFrame = 0;
+	bool hasDiverged = false;
+public:
+	InputPlayer();
+	~InputPlayer();
+
+	bool Open(const std::string& filePath);
+	double GetFixedDeltaTime() const;
+
+	// Loads the next frame, returns false at the end of the recording
+	bool NextFrame(double& frameTime);
+	bool PollEvent(SDL_Event& sdlEvent);
+
+	// Compares the state at the end of the frame with the recorded one
+	void CheckStateHash(uint64_t stateHash);
+	bool HasDiverged() const;
+};
+
+// FNV-1a, used to hash the simulation state
+inline uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+const uint64_t HASH_SEED = 14695981039346656037ull;
@@ -0,0 +1,110 @@
+#include "SystemScheduler.h"
+#include "../Logger/Logger.h"
+#include "../FlightRecorder/FlightRecorder.h"
+
+SystemScheduler::SystemScheduler() {
+	Logger::Log("SystemScheduler constructor called.");
+}
+
+SystemScheduler::~SystemScheduler() {
+	Logger::Err("SystemScheduler destructor called");
+}
+
+void SystemScheduler::SetDebugMode(bool isEnabled) {
+	isDebugMode = isEnabled;
+}
+
+bool SystemScheduler::IsDebugMode() const {
+	return isDebugMode;
+}
+
+void SystemScheduler::Schedule(System& system, std::function<void()> update, bool runOnMainThread) {
+	auto newTask = std::make_unique<SystemTask>();
+	newTask->system = &system;
+
+	auto& updateTimeMetric = updateTimeMetrics[&system];
+	if (!updateTimeMetric) {
+		updateTimeMetric = &Metrics::GetHistogram("systems." + system.GetName() + ".ms");
+	}
+	newTask->updateTimeMetric = updateTimeMetric;
+	newTask->update = std::move(update);
+	newTask->runOnMainThread = runOnMainThread;
+	tasks.push_back(std::move(newTask));
+}
+
+void SystemScheduler::Run(JobSystem& jobSystem) {
+	const int numTasks = static_cast<int>(tasks.size());
+
+	// Every task depends on the previous tasks it conflicts with, so the graph follows the scheduling order
+	for (int i = 0; i < numTasks; i++) {
+		for (int j = i + 1; j < numTasks; j++) {
+			if (tasks[i]->system->ConflictsWith(*tasks[j]->system)) {
+				tasks[i]->dependents.push_back(j);
+				tasks[j]->pendingDependencies++;
+			}
+		}
+	}
+
+	JobCounter counter;
+	for (int i = 0; i < numTasks; i++) {
+		if (tasks[i]->pendingDependencies == 0) {
+			Dispatch(jobSystem, counter, i);
+		}
+	}
+	jobSystem.Wait(counter);
+
+	if (isDebugMode) {
+		for (auto& task: tasks) {
+			const std::string& name = task->system->GetName();
+			Signature undeclared = task->system->TakeUndeclaredAccesses();
+			if (undeclared.any()) {
+				Logger::Err("System " + name + " accessed undeclared components: " + undeclared.to_string());
+			}
+			Signature undeclaredWrites = task->system->TakeUndeclaredWrites();
+			if (undeclaredWrites.any()) {
+				Logger::Err("System " + name + " got write access (GetComponent) to components it doesn't declare as written: " + undeclaredWrites.to_string());
+			}
+		}
+	}
+
+	tasks.clear();
+}
+
+void SystemScheduler::Dispatch(JobSystem& jobSystem, JobCounter& counter, int taskIndex) {
+	auto job = [this, &jobSystem, &counter, taskIndex]() {
+		RunTask(jobSystem, counter, taskIndex);
+	};
+
+	if (tasks[taskIndex]->runOnMainThread) {
+		jobSystem.ScheduleOnMainThread(job, &counter);
+	} else {
+		jobSystem.Schedule(job, &counter);
+	}
+}
+
+void SystemScheduler::RunTask(JobSystem& jobSystem, JobCounter& counter, int taskIndex) {
+	auto& task = tasks[taskIndex];
+
+	// Nested waits can run another task on this thread, so restore whatever was there before
+	System* previousSystem = System::currentSystem;
+	if (isDebugMode) {
+		System::currentSystem = task->system;
+	}
+	const uint64_t start = Profiler::Now();
+	{
+		PROFILE_ZONE(task->system->GetName().c_str());
+		task->update();
+	}
+	const uint64_t end = Profiler::Now();
+	task->system->RecordUpdateTime((end - start) / 1000000.0);
+	task->updateTimeMetric->Record((end - start) / 1000000.0);
+	FlightRecorder::RecordZone(task->system->GetName().c_str(), start, end);
+	System::currentSystem = previousSystem;
+
+	// Release the tasks that were waiting on this one, they are scheduled before our job completes so the counter can't reach zero early
+	for (auto dependent: task->dependents) {
+		if (tasks[dependent]->pendingDependencies.fetch_sub(1) == 1) {
+			Dispatch(jobSystem, counter, dependent);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../JobSystem/JobSystem.h"
+#include "../Metrics/Metrics.h"
+
+struct SystemTask {
+	System* system;
+	MetricHistogram* updateTimeMetric;
+	std::function<void()> update;
+	bool runOnMainThread;
+
+	// Tasks that must wait for this one to finish
+	std::vector<int> dependents;
+	std::atomic<int> pendingDependencies{ 0 };
+};
+
+// Builds a dependency graph out of the systems scheduled during the frame and runs it on the job system
+// Systems that don't conflict on their component access run at the same time, conflicting ones keep the order they were scheduled in
+class SystemScheduler {
+private:
+	std::vector<std::unique_ptr<SystemTask>> tasks;
+	bool isDebugMode = false;
+
+	// Update time histogram of every system ever scheduled, looked up once per system instead of once per frame
+	std::unordered_map<System*, MetricHistogram*> updateTimeMetrics;
+
+	void RunTask(JobSystem& jobSystem, JobCounter& counter, int taskIndex);
+	void Dispatch(JobSystem& jobSystem, JobCounter& counter, int taskIndex);
+public:
+	SystemScheduler();
+	~SystemScheduler();
+
+	// In debug mode every component access is checked against what the system declared
+	void SetDebugMode(bool isEnabled);
+	bool IsDebugMode() const;
+
+	void Schedule(System& system, std::function<void()> update, bool runOnMainThread = false);
+
+	// Executes every scheduled task and waits for all of them, then clears the graph for the next frame
+	void Run(JobSystem& jobSystem);
+};
@@ -0,0 +1,145 @@
+#include "StressTest.h"
+#include "../Logger/Logger.h"
+#include "../Metrics/Percentile.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+// windows.h would otherwise define min and max macros that break std::min
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+size_t GetProcessMemoryUsage() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	// The second value of statm is the resident set size in pages
+	std::ifstream statm("/proc/self/statm");
+	size_t totalPages = 0;
+	size_t residentPages = 0;
+	if (statm >> totalPages >> residentPages) {
+		return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	}
+	return 0;
+#endif
+}
+
+StressTest::StressTest(int numEntities, unsigned int seed): numEntities(numEntities), seed(seed) {
+	Logger::Log("StressTest constructor called with " + std::to_string(numEntities) + " entities.");
+}
+
+StressTest::~StressTest() {
+	Logger::Err("StressTest destructor called");
+}
+
+int StressTest::GetNumEntities() const {
+	return numEntities;
+}
+
+void StressTest::Spawn(Registry& registry, int worldWidth, int worldHeight) {
+	// The entity logs would land in the history arena and be counted as entity memory
+	const bool wasLoggerEnabled = Logger::isEnabled;
+	Logger::SetEnabled(false);
+	memoryBeforeSpawn = GetProcessMemoryUsage();
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> randomX(0.0f, static_cast<float>(worldWidth));
+	std::uniform_real_distribution<float> randomY(0.0f, static_cast<float>(worldHeight));
+	std::uniform_real_distribution<float> randomVelocity(-100.0f, 100.0f);
+
+	for (int i = 0; i < numEntities; i++) {
+		Entity entity = registry.CreateEntity();
+		entity.AddComponent<TransformComponent>(glm::vec2(randomX(random), randomY(random)), glm::vec2(1.0, 1.0), 0.0);
+		entity.AddComponent<RigidBodyComponent>(glm::vec2(randomVelocity(random), randomVelocity(random)));
+
+		// Half tanks, half trucks, a quarter of them flying over the others so the batch sorts several layers
+		const int layer = (i % 8 >= 6) ? LAYER_AIR : LAYER_GROUND;
+		if (i % 2 == 0) {
+			entity.AddComponent<SpriteComponent>("tank-image", 10, 10, layer);
+		} else {
+			entity.AddComponent<SpriteComponent>("truck-image", 10, 10, layer);
+		}
+	}
+	registry.Update();
+
+	memoryAfterSpawn = GetProcessMemoryUsage();
+	Logger::SetEnabled(wasLoggerEnabled);
+	frameMillisecs.reserve(4096);
+}
+
+void StressTest::RecordFrame(double millisecs) {
+	frameMillisecs.push_back(millisecs);
+}
+
+void StressTest::Report(Registry& registry, const std::string& outFilePath) const {
+	std::vector<double> sorted = frameMillisecs;
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (auto millisecs: sorted) {
+		total += millisecs;
+	}
+	const double average = sorted.empty() ? 0.0 : total / sorted.size();
+	const size_t memoryNow = GetProcessMemoryUsage();
+
+	Logger::Log(
+		"Stress test with " + std::to_string(numEntities) + " entities, " + std::to_string(sorted.size()) + " frames:" +
+		" avg: " + std::to_string(average) + "ms" +
+		" p50: " + std::to_string(GetPercentile(sorted, 50)) + "ms" +
+		" p95: " + std::to_string(GetPercentile(sorted, 95)) + "ms" +
+		" p99: " + std::to_string(GetPercentile(sorted, 99)) + "ms" +
+		" memory: " + std::to_string(memoryNow / 1024) + "KB" +
+		" (spawn: " + std::to_string((memoryAfterSpawn - std::min(memoryBeforeSpawn, memoryAfterSpawn)) / 1024) + "KB)"
+	);
+	for (auto system: registry.GetSystems()) {
+		Logger::Log(
+			"  " + system->GetName() + ": " + std::to_string(system->GetAverageUpdateMillisecs()) + "ms avg over " +
+			std::to_string(system->GetNumUpdates()) + " updates, " + std::to_string(system->GetNumEntities()) + " entities"
+		);
+	}
+
+	if (outFilePath.empty()) {
+		return;
+	}
+
+	// Same layout as the ECS benchmark results so the same tools can read both
+	std::ostringstream json;
+	json << "{\n";
+	json << "  \"suite\": \"stress\",\n";
+	json << "  \"entities\": " << numEntities << ",\n";
+	json << "  \"memory_bytes\": " << memoryNow << ",\n";
+	json << "  \"spawn_memory_bytes\": " << memoryAfterSpawn - std::min(memoryBeforeSpawn, memoryAfterSpawn) << ",\n";
+	json << "  \"results\": [\n";
+	json << "    {\"name\": \"Frame\", \"entities\": " << numEntities << ", \"operations\": " << sorted.size();
+	json << ", \"median_ns_per_op\": " << GetPercentile(sorted, 50) * 1e6;
+	json << ", \"p95_ns_per_op\": " << GetPercentile(sorted, 95) * 1e6;
+	json << ", \"p99_ns_per_op\": " << GetPercentile(sorted, 99) * 1e6;
+	json << ", \"samples_ns_per_op\": [";
+	for (size_t i = 0; i < frameMillisecs.size(); i++) {
+		json << (i > 0 ? ", " : "") << frameMillisecs[i] * 1e6;
+	}
+	json << "]}";
+	for (auto system: registry.GetSystems()) {
+		json << ",\n    {\"name\": \"" << system->GetName() << "\", \"entities\": " << system->GetNumEntities();
+		json << ", \"operations\": " << system->GetNumUpdates();
+		json << ", \"mean_ns_per_op\": " << system->GetAverageUpdateMillisecs() * 1e6 << "}";
+	}
+	json << "\n  ]\n";
+	json << "}\n";
+
+	std::ofstream(outFilePath) << json.str();
+	Logger::Log("Stress test results written to " + outFilePath);
+}
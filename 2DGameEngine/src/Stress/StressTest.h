@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ECS/ECS.h"
+
+// Resident memory of the whole process in bytes, 0 if the platform doesn't tell
+size_t GetProcessMemoryUsage();
+
+// Stress scenario: spawns lots of tanks and trucks with random velocities and measures how the whole loop copes
+class StressTest {
+private:
+	int numEntities;
+	unsigned int seed;
+	std::vector<double> frameMillisecs;
+	size_t memoryBeforeSpawn = 0;
+	size_t memoryAfterSpawn = 0;
+public:
+	StressTest(int numEntities, unsigned int seed = 1234);
+	~StressTest();
+
+	int GetNumEntities() const;
+
+	// Same seed, same scene, so runs can be compared with each other
+	void Spawn(Registry& registry, int worldWidth, int worldHeight);
+
+	void RecordFrame(double millisecs);
+
+	// Logs average and percentile frame times, the time of every system and the memory use
+	// and writes the same data as JSON when outFilePath is not empty
+	void Report(Registry& registry, const std::string& outFilePath) const;
+};
@@ -8,16 +8,19 @@ public:
 	MovementSystem() {
 		RequiredComponent<TransformComponent>();
 		RequiredComponent<RigidBodyComponent>();
+
+		WritesComponent<TransformComponent>();
 	}
 
-	void Update(double deltaTime) {
-		for (auto entity: GetSystemEntities()) {
+	void Update(double deltaTime, JobSystem& jobSystem) {
+		// Every entity only touches its own components, so the list can be split across the workers
+		ParallelEach(jobSystem, [deltaTime](Entity entity) {
 
 			auto& transform = entity.GetComponent<TransformComponent>();
-			const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+			const auto& rigidBody = entity.ReadComponent<RigidBodyComponent>();
 
 			transform.position.x += rigidBody.velocity.x * deltaTime;
 			transform.position.y += rigidBody.velocity.y * deltaTime;
-		}
+		});
 	}
 };
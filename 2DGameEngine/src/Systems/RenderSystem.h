@@ -1,28 +1,64 @@
 #pragma once
 #include "../ECS/ECS.h"
 #include "../Components/TransformComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../AssetBank/AssetBank.h"
+#include "../Renderer/SpriteBatch.h"
 #include <SDL.h>
+#include <cmath>
 
 class RenderSystem : public System {
+private:
+	SpriteBatch spriteBatch;
+
+	// Brings a rotation difference in degrees to [-180, 180], so going from 350 to 10 turns 20 degrees and not 340 back
+	static double ShortestAngle(double degrees) {
+		degrees = std::fmod(degrees, 360.0);
+		if (degrees > 180.0) {
+			degrees -= 360.0;
+		} else if (degrees < -180.0) {
+			degrees += 360.0;
+		}
+		return degrees;
+	}
 public:
 	RenderSystem() {
 		RequiredComponent<TransformComponent>();
 		RequiredComponent<SpriteComponent>();
+
+		// The resolved texture is cached on the sprite
+		WritesComponent<SpriteComponent>();
 	}
 
-	void Update(SDL_Renderer* renderer) {
+	// interpolation goes from 0 (previous simulation step) to 1 (current simulation step)
+	void Update(SDL_Renderer* renderer, AssetBank& assetBank, double interpolation = 1.0) {
+		// Nothing to draw on when running headless
+		if (!renderer) {
+			return;
+		}
+
+		spriteBatch.Begin();
 		for (auto entity: GetSystemEntities()) {
-			const auto transform = entity.GetComponent<TransformComponent>();
-			const auto sprite = entity.GetComponent<SpriteComponent>();
-
-			SDL_Rect objRect = {
-				static_cast<int>(transform.position.x),
-				static_cast<int>(transform.position.y),
-				sprite.width,
-				sprite.height
-			};
-			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-			SDL_RenderFillRect(renderer, &objRect);
+			const auto& transform = entity.ReadComponent<TransformComponent>();
+			const auto& previousTransform = entity.GetPreviousComponent<TransformComponent>();
+			auto& sprite = entity.GetComponent<SpriteComponent>();
+
+			// Draw in between the last two simulation steps so the movement looks smooth at any render rate
+			glm::vec2 position = glm::mix(previousTransform.position, transform.position, static_cast<float>(interpolation));
+			double rotation = previousTransform.rotation + ShortestAngle(transform.rotation - previousTransform.rotation) * interpolation;
+
+			// The asset id is only looked up again after the bank changed, a missing texture draws a plain white quad
+			if (sprite.textureGeneration != assetBank.GetGeneration()) {
+				sprite.texture = assetBank.GetTexture(sprite.assetId);
+				sprite.textureGeneration = assetBank.GetGeneration();
+			}
+			glm::vec2 size = glm::vec2(sprite.width, sprite.height) * transform.scale;
+			spriteBatch.Add(sprite.texture, position, size, static_cast<float>(rotation), sprite.zIndex);
 		}
+		spriteBatch.Flush(renderer);
+	}
+
+	const SpriteBatch& GetSpriteBatch() const {
+		return spriteBatch;
 	}
 };
@@ -0,0 +1,167 @@
+#include "World.h"
+#include <SDL.h>
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Systems/MovementSystem.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include "../FramePacer/FramePacer.h"
+#include "../Metrics/Metrics.h"
+
+// Sends the logs of the calling thread to a world history while the scope lasts
+class ScopedWorldLog {
+private:
+	LogHistory* previousHistory;
+public:
+	ScopedWorldLog(LogHistory& history) {
+		previousHistory = Logger::threadHistory;
+		Logger::threadHistory = &history;
+	}
+	~ScopedWorldLog() {
+		Logger::threadHistory = previousHistory;
+	}
+};
+
+World::World(const std::string& name): name(name) {
+	ScopedWorldLog scopedLog(messages);
+	registry = std::make_unique<Registry>();
+	systemScheduler = std::make_unique<SystemScheduler>();
+
+	Logger::Log("World " + name + " created.");
+}
+
+World::~World() {
+	ScopedWorldLog scopedLog(messages);
+	systemScheduler.reset();
+	registry.reset();
+
+	// The logger thread may still be adding to our history
+	Logger::Flush();
+}
+
+const std::string& World::GetName() const {
+	return name;
+}
+
+Registry& World::GetRegistry() {
+	return *registry;
+}
+
+const LogHistory& World::GetMessages() const {
+	Logger::Flush();
+	return messages;
+}
+
+uint64_t World::GetTickCount() const {
+	return tickCount;
+}
+
+void World::Setup() {
+	ScopedWorldLog scopedLog(messages);
+
+	registry->AddSystem<MovementSystem>();
+	SpawnDefaultUnits(*registry);
+	registry->Update();
+}
+
+void World::SpawnDefaultUnits(Registry& registry) {
+	Entity tank = registry.CreateEntity();
+	Entity truck = registry.CreateEntity();
+
+	tank.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(1.0, 1.0), 0.0);
+	tank.AddComponent<RigidBodyComponent>(glm::vec2(40.0, 10.0));
+	tank.AddComponent<SpriteComponent>("tank-image", 10, 10, LAYER_GROUND);
+
+	truck.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(1.0, 1.0), 0.0);
+	truck.AddComponent<RigidBodyComponent>(glm::vec2(40.0, 10.0));
+	truck.AddComponent<SpriteComponent>("truck-image", 10, 50, LAYER_GROUND);
+}
+
+void World::Update(double deltaTime, JobSystem& jobSystem) {
+	ScopedWorldLog scopedLog(messages);
+
+	registry->SwapBuffers();
+
+	if (registry->HasSystem<MovementSystem>()) {
+		systemScheduler->Schedule(registry->GetSystem<MovementSystem>(), [this, deltaTime, &jobSystem]() {
+			registry->GetSystem<MovementSystem>().Update(deltaTime, jobSystem);
+		});
+	}
+	systemScheduler->Run(jobSystem);
+
+	registry->Update();
+	tickCount++;
+}
+
+WorldHost::WorldHost(JobSystem& jobSystem): jobSystem(jobSystem) {
+	Logger::Log("WorldHost constructor called.");
+}
+
+WorldHost::~WorldHost() {
+	worlds.clear();
+	Logger::Err("WorldHost destructor called");
+}
+
+World& WorldHost::CreateWorld(const std::string& name) {
+	worlds.push_back(std::make_unique<World>(name));
+	return *worlds.back();
+}
+
+int WorldHost::GetNumWorlds() const {
+	return static_cast<int>(worlds.size());
+}
+
+World& WorldHost::GetWorld(int index) {
+	return *worlds[index];
+}
+
+void WorldHost::Update(double deltaTime) {
+	JobCounter counter;
+	for (auto& world: worlds) {
+		World* worldToUpdate = world.get();
+		jobSystem.Schedule([this, worldToUpdate, deltaTime]() {
+			worldToUpdate->Update(deltaTime, jobSystem);
+		}, &counter);
+	}
+	jobSystem.Wait(counter);
+}
+
+void WorldHost::Run(int tickRate, uint64_t maxFrames) {
+	FramePacer framePacer(tickRate);
+	const double deltaTime = 1.0 / (tickRate > 0 ? tickRate : 60);
+
+	MetricHistogram& tickTimeMetric = Metrics::GetHistogram("server.tick_ms");
+	MetricCounter& ticksMetric = Metrics::GetCounter("server.ticks");
+	MetricGauge& entitiesMetric = Metrics::GetGauge("server.entities");
+	MetricHistogram& queueDepthMetric = Metrics::GetHistogram("jobs.queue_depth");
+
+	for (uint64_t frame = 0; maxFrames == 0 || frame < maxFrames; frame++) {
+		// Ctrl+C stops the server cleanly when SDL handles the events
+		if (SDL_WasInit(SDL_INIT_EVENTS) && SDL_QuitRequested()) {
+			break;
+		}
+
+		const uint64_t tickStart = Profiler::Now();
+		{
+			FlightRecorderZone zone("Update");
+			Update(deltaTime);
+		}
+		const uint64_t tickEnd = Profiler::Now();
+		tickTimeMetric.Record((tickEnd - tickStart) / 1000000.0);
+		ticksMetric.Add();
+
+		int numEntities = 0;
+		for (auto& world: worlds) {
+			numEntities += world->GetRegistry().GetNumEntities();
+		}
+		entitiesMetric.Set(numEntities);
+
+		// A slow tick dumps the last seconds of every world, the same way a slow frame does in the game
+		FlightRecorder::EndFrame(frame, tickStart, tickEnd, numEntities);
+		queueDepthMetric.Record(jobSystem.TakePeakQueuedJobs());
+
+		framePacer.WaitForNextFrame();
+	}
+
+	framePacer.LogReport();
+}
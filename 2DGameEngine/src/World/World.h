@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../JobSystem/JobSystem.h"
+#include "../Scheduler/SystemScheduler.h"
+#include "../Logger/Logger.h"
+
+// An independent simulation: its own registry, scheduler and log history, nothing is shared with other worlds
+class World {
+private:
+	std::string name;
+	std::unique_ptr<Registry> registry;
+	std::unique_ptr<SystemScheduler> systemScheduler;
+	LogHistory messages{ 1024, 64 * 1024 };
+	uint64_t tickCount = 0;
+public:
+	World(const std::string& name);
+	~World();
+
+	const std::string& GetName() const;
+	Registry& GetRegistry();
+	const LogHistory& GetMessages() const;
+	uint64_t GetTickCount() const;
+
+	// Adds the game systems and spawns the default units
+	void Setup();
+
+	// The units every match starts with, shared with Game::Setup()
+	static void SpawnDefaultUnits(Registry& registry);
+
+	// Runs one simulation step, the systems of the world can use the job system too
+	void Update(double deltaTime, JobSystem& jobSystem);
+};
+
+// Ticks many worlds in the same process (dedicated servers), every world runs as a job on the shared pool
+class WorldHost {
+private:
+	JobSystem& jobSystem;
+	std::vector<std::unique_ptr<World>> worlds;
+public:
+	WorldHost(JobSystem& jobSystem);
+	~WorldHost();
+
+	World& CreateWorld(const std::string& name);
+	int GetNumWorlds() const;
+	World& GetWorld(int index);
+
+	// Steps every world once and waits until all of them are done
+	void Update(double deltaTime);
+
+	// Server loop: ticks all the worlds at tickRate (0 = uncapped) until maxFrames frames have run (0 = forever)
+	void Run(int tickRate, uint64_t maxFrames);
+};
@@ -0,0 +1,158 @@
+// Checks the job system helpers from threads it owns and from threads it doesn't, returns non zero on the first failure
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ECS/ECS.h"
+#include "JobSystem/JobSystem.h"
+#include "Logger/Logger.h"
+#include "Components/TransformComponent.h"
+
+static std::atomic<int> failures{ 0 };
+
+static void Check(bool condition, const std::string& what) {
+	if (!condition) {
+		std::cerr << "FAILED: " << what << std::endl;
+		failures++;
+	}
+}
+
+class SumSystem : public System {
+public:
+	SumSystem() {
+		RequiredComponent<TransformComponent>();
+	}
+
+	long long SumIds(JobSystem& jobSystem, int grainSize) {
+		return ParallelEachReduce(jobSystem, 0LL, [](Entity entity, long long& local) {
+			local += entity.GetId();
+		}, [](long long a, long long b) {
+			return a + b;
+		}, grainSize);
+	}
+};
+
+static void TestParallelReduce(JobSystem& jobSystem, const std::string& thread) {
+	const int count = 100000;
+	const long long expected = static_cast<long long>(count) * (count - 1) / 2;
+	for (int grainSize: { 0, 1000, count, 2 * count }) {
+		long long sum = jobSystem.ParallelReduce(count, grainSize, 0LL, [](int begin, int end, long long& local) {
+			for (int i = begin; i < end; i++) {
+				local += i;
+			}
+		}, [](long long a, long long b) {
+			return a + b;
+		});
+		Check(sum == expected, "ParallelReduce from " + thread + " with grain size " + std::to_string(grainSize));
+	}
+}
+
+static void TestParallelEachReduce(JobSystem& jobSystem, SumSystem& system, int numEntities, const std::string& thread) {
+	const long long expected = static_cast<long long>(numEntities) * (numEntities - 1) / 2;
+	for (int grainSize: { 0, 64, numEntities }) {
+		Check(system.SumIds(jobSystem, grainSize) == expected, "ParallelEachReduce from " + thread + " with grain size " + std::to_string(grainSize));
+	}
+}
+
+// Every job logs into the history of the thread that scheduled it, even when a worker runs it inside another job's Wait()
+static void TestLogsFollowJobs(JobSystem& jobSystem) {
+	Logger::SetEnabled(true);
+	LogHistory historyA;
+	LogHistory historyB;
+	const size_t sharedBefore = Logger::history.GetSize();
+
+	auto scheduleWorld = [&jobSystem](LogHistory& history, const std::string& name, JobCounter& counter) {
+		jobSystem.Schedule([&jobSystem, &history, name]() {
+			Logger::threadHistory = &history;
+			jobSystem.ParallelFor(64, 1, [&name](int begin, int) {
+				Logger::Log(name + " chunk " + std::to_string(begin));
+			});
+			Logger::threadHistory = nullptr;
+		}, &counter);
+	};
+	JobCounter counter;
+	scheduleWorld(historyA, "A", counter);
+	scheduleWorld(historyB, "B", counter);
+	jobSystem.Wait(counter);
+	Logger::Flush();
+
+	auto countPrefix = [](const LogHistory& history, const std::string& prefix) {
+		int count = 0;
+		for (const LogEntry& entry: history.Query(LogHistoryFilter())) {
+			count += entry.message.compare(0, prefix.size(), prefix) == 0;
+		}
+		return count;
+	};
+	Check(countPrefix(historyA, "A ") == 64 && countPrefix(historyA, "B ") == 0, "world A history holds exactly its own chunks");
+	Check(countPrefix(historyB, "B ") == 64 && countPrefix(historyB, "A ") == 0, "world B history holds exactly its own chunks");
+	Check(Logger::history.GetSize() == sharedBefore, "no chunk logged into the shared history");
+	Logger::SetEnabled(false);
+}
+
+// A worker of one pool scheduling on another pool must not push into the other pool's deques
+static void TestNestedPools(JobSystem& jobSystem) {
+	{
+		JobSystem otherJobSystem(2);
+		Check(otherJobSystem.GetCurrentThreadIndex() == 0, "the thread that creates a job system is its main thread");
+		Check(jobSystem.GetCurrentThreadIndex() == 0, "a second pool doesn't take the main thread from the first one");
+
+		std::atomic<int> total{ 0 };
+		JobCounter counter;
+		for (int i = 0; i < 64; i++) {
+			jobSystem.Schedule([&jobSystem, &otherJobSystem, &total]() {
+				// The main thread created both pools, only the workers are foreign to the other one
+				if (jobSystem.GetCurrentThreadIndex() > 0) {
+					Check(otherJobSystem.GetCurrentThreadIndex() == -1, "a worker of another pool is a foreign thread");
+				}
+				JobCounter innerCounter;
+				for (int j = 0; j < 16; j++) {
+					otherJobSystem.Schedule([&total]() {
+						total.fetch_add(1);
+					}, &innerCounter);
+				}
+				otherJobSystem.Wait(innerCounter);
+			}, &counter);
+		}
+		jobSystem.Wait(counter);
+		Check(total.load() == 64 * 16, "jobs scheduled across pools all ran");
+	}
+
+	// Destroying the nested pool must leave the main thread to the first one
+	Check(jobSystem.IsMainThread(), "the main thread still belongs to the first pool after the nested one is destroyed");
+	Check(jobSystem.GetCurrentThreadIndex() == 0, "the main thread keeps its deque in the first pool");
+	TestParallelReduce(jobSystem, "the main thread after a nested pool");
+}
+
+int main() {
+	Logger::SetEnabled(false);
+	JobSystem jobSystem(3);
+
+	const int numEntities = 10000;
+	Registry registry;
+	registry.AddSystem<SumSystem>();
+	for (int i = 0; i < numEntities; i++) {
+		registry.CreateEntity().AddComponent<TransformComponent>();
+	}
+	registry.Update();
+	SumSystem& system = registry.GetSystem<SumSystem>();
+
+	TestParallelReduce(jobSystem, "the main thread");
+	TestParallelEachReduce(jobSystem, system, numEntities, "the main thread");
+
+	// The chunks run inline or inside Wait() on a thread the job system doesn't know about
+	std::thread foreignThread([&]() {
+		TestParallelReduce(jobSystem, "a foreign thread");
+		TestParallelEachReduce(jobSystem, system, numEntities, "a foreign thread");
+	});
+	foreignThread.join();
+
+	TestLogsFollowJobs(jobSystem);
+	TestNestedPools(jobSystem);
+
+	if (failures > 0) {
+		return 1;
+	}
+	std::cout << "JobSystemTest passed" << std::endl;
+	return 0;
+}
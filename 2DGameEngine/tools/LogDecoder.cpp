@@ -0,0 +1,120 @@
+// Turns a binary log written by BinaryLog back into text, one line per entry:
+// LogDecoder game.blog [--category ECS] [--level DBG|LOG|WRN|ERR]
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "Logger/BinaryLog.h"
+
+static const char* LEVEL_NAMES[] = { "DBG", "LOG", "WRN", "ERR" };
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: LogDecoder <file.blog> [--category <name>] [--level DBG|LOG|WRN|ERR]" << std::endl;
+		return 2;
+	}
+	std::string categoryFilter;
+	int minLevel = LOG_DEBUG;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg == "--category") {
+			categoryFilter = argv[i + 1];
+		} else if (arg == "--level") {
+			for (int level = 0; level < 4; level++) {
+				if (LEVEL_NAMES[level] == std::string(argv[i + 1])) {
+					minLevel = level;
+				}
+			}
+		}
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	BinaryLogFileHeader header;
+	if (data.size() < sizeof(header) || std::memcmp(data.data(), "2DBL", 4) != 0) {
+		std::cerr << "Not a binary log: " << argv[1] << std::endl;
+		return 1;
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (header.version != BinaryLog::VERSION) {
+		std::cerr << "Unsupported binary log version " << header.version << std::endl;
+		return 1;
+	}
+
+	std::map<uint32_t, BinaryLogFormat> formats;
+	uint64_t numEntries = 0;
+	uint64_t numUnpublished = 0;
+	size_t offset = sizeof(header);
+	while (offset + sizeof(BinaryLogEntryHeader) <= data.size()) {
+		BinaryLogEntryHeader entry;
+		std::memcpy(&entry, data.data() + offset, sizeof(entry));
+
+		// The rest of the file was never written
+		if (entry.size < sizeof(entry) || offset + entry.size > data.size()) {
+			break;
+		}
+		const char* payload = data.data() + offset + sizeof(entry);
+		const size_t payloadSize = entry.size - sizeof(entry);
+		offset += (entry.size + 7) & ~size_t{ 7 };
+
+		// Reserved but never published, the writer died or was still writing when the process crashed
+		if (entry.formatId == 0) {
+			numUnpublished++;
+			continue;
+		}
+
+		if (entry.formatId == BinaryLog::FORMAT_DEFINITION_ID) {
+			uint32_t formatId;
+			uint8_t level, category;
+			uint16_t numArgs, formatLength;
+			const char* in = payload;
+			std::memcpy(&formatId, in, 4); in += 4;
+			std::memcpy(&level, in, 1); in += 1;
+			std::memcpy(&category, in, 1); in += 1;
+			std::memcpy(&numArgs, in, 2); in += 2;
+			std::string argTypes(in, numArgs); in += numArgs;
+			std::memcpy(&formatLength, in, 2); in += 2;
+			formats[formatId] = BinaryLogFormat{ static_cast<LogType>(level), static_cast<LogCategory>(category), std::string(in, formatLength), argTypes };
+			continue;
+		}
+
+		auto format = formats.find(entry.formatId);
+		if (format == formats.end()) {
+			std::cout << "<unknown format " << entry.formatId << ">" << std::endl;
+			continue;
+		}
+		const BinaryLogFormat& info = format->second;
+		const char* categoryName = info.category < LOG_CATEGORY_COUNT ? Logger::GetCategoryName(info.category) : "?";
+		if (info.level < minLevel || (!categoryFilter.empty() && categoryFilter != categoryName)) {
+			continue;
+		}
+
+		// Steady clock entries placed on the wall clock the file was opened at
+		const int64_t wallClock = header.wallClockNanosecs + static_cast<int64_t>(entry.timestamp - header.steadyClockNanosecs);
+		const std::time_t seconds = static_cast<std::time_t>(wallClock / 1000000000);
+		std::tm time;
+#ifdef _WIN32
+		localtime_s(&time, &seconds);
+#else
+		localtime_r(&seconds, &time);
+#endif
+		char timeString[32];
+		std::strftime(timeString, sizeof(timeString), "%d-%b-%y %H:%M:%S", &time);
+
+		std::printf("%s: [%s.%06lld] [%s] %s\n", LEVEL_NAMES[info.level < 4 ? info.level : 0], timeString,
+			static_cast<long long>((wallClock % 1000000000) / 1000), categoryName,
+			BinaryLog::FormatMessage(info.format, info.argTypes, payload, payloadSize).c_str());
+		numEntries++;
+	}
+
+	std::cerr << numEntries << " entries, " << formats.size() << " formats";
+	if (numUnpublished > 0) {
+		std::cerr << ", " << numUnpublished << " unfinished entries skipped";
+	}
+	std::cerr << std::endl;
+	return 0;
+}